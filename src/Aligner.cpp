@@ -4,6 +4,14 @@
 #include <functional>
 #include <algorithm>
 #include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
 #include <concurrentqueue.h> //https://github.com/cameron314/concurrentqueue
 #include <google/protobuf/util/json_util.h>
 #include "Aligner.h"
@@ -17,12 +25,18 @@
 #include "MummerSeeder.h"
 #include "ReadCorrection.h"
 #include "MinimizerSeeder.h"
+#include "FileSeeder.h"
+#include "PipelineQueue.h"
+#include "AlignmentTaskPool.h"
+#include "NumaPlacement.h"
+#include "BgzfCompression.h"
+#include "BinaryAlignment.h"
 
 struct Seeder
 {
 	enum Mode
 	{
-		None, File, Mum, Mem, Minimizer
+		None, File, Mum, Mem, Minimizer, Syncmer
 	};
 	Mode mode;
 	size_t mumCount;
@@ -32,10 +46,14 @@ struct Seeder
 	size_t minimizerWindowSize;
 	size_t minimizerCount;
 	size_t minimizerChunkSize;
+	size_t syncmerLength;
+	size_t syncmerSmerLength;
+	size_t syncmerCount;
+	size_t syncmerChunkSize;
 	const MummerSeeder* mummerSeeder;
 	const MinimizerSeeder* minimizerSeeder;
-	const std::unordered_map<std::string, std::vector<SeedHit>>* fileSeeds;
-	Seeder(const AlignerParams& params, const std::unordered_map<std::string, std::vector<SeedHit>>* fileSeeds, const MummerSeeder* mummerSeeder, const MinimizerSeeder* minimizerSeeder) :
+	const FileSeeder* fileSeeds;
+	Seeder(const AlignerParams& params, const FileSeeder* fileSeeds, const MummerSeeder* mummerSeeder, const MinimizerSeeder* minimizerSeeder) :
 		mumCount(params.mumCount),
 		memCount(params.memCount),
 		mxmLength(params.mxmLength),
@@ -43,6 +61,10 @@ struct Seeder
 		minimizerWindowSize(params.minimizerWindowSize),
 		minimizerCount(params.minimizerCount),
 		minimizerChunkSize(params.minimizerChunkSize),
+		syncmerLength(params.syncmerLength),
+		syncmerSmerLength(params.syncmerSmerLength),
+		syncmerCount(params.syncmerCount),
+		syncmerChunkSize(params.syncmerChunkSize),
 		mummerSeeder(mummerSeeder),
 		minimizerSeeder(minimizerSeeder),
 		fileSeeds(fileSeeds)
@@ -55,6 +77,7 @@ struct Seeder
 			assert(mumCount == 0);
 			assert(memCount == 0);
 			assert(minimizerCount == 0);
+			assert(syncmerCount == 0);
 			mode = Mode::File;
 		}
 		if (minimizerSeeder != nullptr)
@@ -62,8 +85,17 @@ struct Seeder
 			assert(mummerSeeder == nullptr);
 			assert(mumCount == 0);
 			assert(memCount == 0);
-			assert(minimizerCount != 0);
-			mode = Mode::Minimizer;
+			assert(minimizerCount != 0 || syncmerCount != 0);
+			if (minimizerCount != 0)
+			{
+				mode = Mode::Minimizer;
+				assert(syncmerCount == 0);
+			}
+			if (syncmerCount != 0)
+			{
+				mode = Mode::Syncmer;
+				assert(minimizerCount == 0);
+			}
 		}
 		if (mummerSeeder != nullptr)
 		{
@@ -71,6 +103,7 @@ struct Seeder
 			assert(fileSeeds == nullptr);
 			assert(mumCount != 0 || memCount != 0);
 			assert(minimizerCount == 0);
+			assert(syncmerCount == 0);
 			if (mumCount != 0)
 			{
 				mode = Mode::Mum;
@@ -89,8 +122,7 @@ struct Seeder
 		{
 			case Mode::File:
 				assert(fileSeeds != nullptr);
-				if (fileSeeds->count(seqName) == 0) return std::vector<SeedHit>{};
-				return fileSeeds->at(seqName);
+				return fileSeeds->getSeeds(seqName);
 			case Mode::Mum:
 				assert(mummerSeeder != nullptr);
 				return mummerSeeder->getMumSeeds(seq, mumCount, mxmLength);
@@ -100,6 +132,9 @@ struct Seeder
 			case Mode::Minimizer:
 				assert(minimizerSeeder != nullptr);
 				return minimizerSeeder->getSeeds(seq, minimizerCount, minimizerChunkSize);
+			case Mode::Syncmer:
+				assert(minimizerSeeder != nullptr);
+				return minimizerSeeder->getSeeds(seq, syncmerCount, syncmerChunkSize);
 			case Mode::None:
 				assert(false);
 		}
@@ -146,6 +181,7 @@ bool is_file_exist(std::string fileName)
 	return infile.good();
 }
 
+//the GAM output gets the same node ids as the binary records, so BinaryAlignment::FromVG doesn't convert them again
 void replaceDigraphNodeIdsWithOriginalNodeIds(vg::Alignment& alignment, const AlignmentGraph& graph)
 {
 	for (int i = 0; i < alignment.path().mapping_size(); i++)
@@ -161,38 +197,538 @@ void replaceDigraphNodeIdsWithOriginalNodeIds(vg::Alignment& alignment, const Al
 	}
 }
 
-void readFastqs(const std::vector<std::string>& filenames, moodycamel::ConcurrentQueue<std::shared_ptr<FastQ>>& writequeue, std::atomic<bool>& readStreamingFinished)
+//reads are handed to the aligner threads in batches packed into one buffer,
+//and the batches are recycled so the buffers are allocated only once
+struct ReadBatch
+{
+	static constexpr size_t MaxReads = 256;
+	static constexpr size_t MaxBases = 100000;
+	void clear()
+	{
+		readNumbers.clear();
+		names.clear();
+		sequences.clear();
+		nameStarts.assign(1, 0);
+		sequenceStarts.assign(1, 0);
+	}
+	void add(const FastQView& read, size_t readNumber)
+	{
+		readNumbers.push_back(readNumber);
+		names.append(read.seq_id.data, read.seq_id.size);
+		sequences.append(read.sequence.data, read.sequence.size);
+		nameStarts.push_back(names.size());
+		sequenceStarts.push_back(sequences.size());
+	}
+	size_t size() const
+	{
+		return nameStarts.size() - 1;
+	}
+	bool full() const
+	{
+		return size() >= MaxReads || sequences.size() >= MaxBases;
+	}
+	size_t readLength(size_t index) const
+	{
+		assert(index < size());
+		return sequenceStarts[index+1] - sequenceStarts[index];
+	}
+	FastQView getReadView(size_t index) const
+	{
+		assert(index < size());
+		FastQView result;
+		result.seq_id = StringView { names.data() + nameStarts[index], nameStarts[index+1] - nameStarts[index] };
+		result.sequence = StringView { sequences.data() + sequenceStarts[index], sequenceStarts[index+1] - sequenceStarts[index] };
+		return result;
+	}
+	void getRead(size_t index, FastQ& read) const
+	{
+		assert(index < size());
+		read.seq_id.assign(names, nameStarts[index], nameStarts[index+1] - nameStarts[index]);
+		read.sequence.assign(sequences, sequenceStarts[index], sequenceStarts[index+1] - sequenceStarts[index]);
+	}
+	size_t memoryBytes() const
+	{
+		return sizeof(ReadBatch) + names.size() + sequences.size() + (readNumbers.size() + nameStarts.size() + sequenceStarts.size()) * sizeof(size_t);
+	}
+	//position of each read in the input, counting from 0
+	std::vector<size_t> readNumbers;
+	std::string names;
+	std::string sequences;
+	std::vector<size_t> nameStarts;
+	std::vector<size_t> sequenceStarts;
+};
+
+ReadBatch* getEmptyBatch(moodycamel::ConcurrentQueue<ReadBatch*>& recycledBatches)
+{
+	ReadBatch* result = nullptr;
+	if (!recycledBatches.try_dequeue(result)) result = new ReadBatch;
+	result->clear();
+	return result;
+}
+
+//packs reads into batches and hands the full batches to the aligner threads
+class ReadDispatcher
+{
+public:
+	ReadDispatcher(PipelineQueue<ReadBatch*>& writequeue, moodycamel::ConcurrentQueue<ReadBatch*>& recycledBatches) :
+	writequeue(writequeue),
+	recycledBatches(recycledBatches),
+	token(writequeue.rawQueue()),
+	batch(getEmptyBatch(recycledBatches))
+	{
+	}
+	void add(const FastQView& read, size_t readNumber)
+	{
+		batch->add(read, readNumber);
+		if (batch->full())
+		{
+			writequeue.enqueue(token, batch);
+			batch = getEmptyBatch(recycledBatches);
+		}
+	}
+	void finish()
+	{
+		if (batch->size() > 0)
+		{
+			writequeue.enqueue(token, batch);
+		}
+		else
+		{
+			recycledBatches.enqueue(batch);
+		}
+		batch = nullptr;
+	}
+private:
+	PipelineQueue<ReadBatch*>& writequeue;
+	moodycamel::ConcurrentQueue<ReadBatch*>& recycledBatches;
+	moodycamel::ProducerToken token;
+	ReadBatch* batch;
+};
+
+//collects a window of reads and dispatches them longest first, so the longest reads don't end up
+//as the last ones being aligned while the other threads are idle.
+//every read of a window is dispatched before any read of the next window, so no read is delayed by more than one window
+class LongestFirstScheduler
+{
+public:
+	LongestFirstScheduler(ReadDispatcher& dispatcher, size_t windowSize) :
+	dispatcher(dispatcher),
+	windowSize(windowSize),
+	window(),
+	order()
+	{
+		window.clear();
+	}
+	void add(const FastQView& read, size_t readNumber)
+	{
+		window.add(read, readNumber);
+		if (window.size() >= windowSize) dispatchWindow();
+	}
+	void finish()
+	{
+		dispatchWindow();
+	}
+private:
+	void dispatchWindow()
+	{
+		order.resize(window.size());
+		for (size_t i = 0; i < order.size(); i++) order[i] = i;
+		//stable so reads of the same length keep their input order
+		std::stable_sort(order.begin(), order.end(), [this](size_t left, size_t right) { return window.readLength(left) > window.readLength(right); });
+		for (auto index : order)
+		{
+			dispatcher.add(window.getReadView(index), window.readNumbers[index]);
+		}
+		window.clear();
+	}
+	ReadDispatcher& dispatcher;
+	size_t windowSize;
+	ReadBatch window;
+	std::vector<size_t> order;
+};
+
+void readFastqs(const std::vector<std::string>& filenames, PipelineQueue<ReadBatch*>& writequeue, moodycamel::ConcurrentQueue<ReadBatch*>& recycledBatches, FileSeeder* fileSeeder, size_t schedulingWindow)
 {
 	assertSetRead("Read streamer", "No seed");
+	ReadDispatcher dispatcher { writequeue, recycledBatches };
+	LongestFirstScheduler scheduler { dispatcher, schedulingWindow };
+	size_t readCount = 0;
+	std::string readName;
 	for (auto filename : filenames)
 	{
-		FastQ::streamFastqFromFile(filename, false, [&writequeue](FastQ& read)
+		//reads are copied straight from the parser's buffer into the batch
+		FastQ::streamFastqViewsFromFile(filename, false, [&dispatcher, &scheduler, &readCount, &readName, fileSeeder, schedulingWindow](const FastQView& read)
 		{
-			std::shared_ptr<FastQ> ptr = std::make_shared<FastQ>();
-			std::swap(*ptr, read);
-			size_t slept = 0;
-			while (writequeue.size_approx() > 200)
+			//streamed seeds must be ready before any aligner thread can see the read
+			if (fileSeeder != nullptr)
 			{
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
-				slept++;
-				if (slept > 100) break;
+				read.seq_id.copyTo(readName);
+				fileSeeder->prepareSeeds(readName);
 			}
-			writequeue.enqueue(ptr);
+			if (schedulingWindow > 1)
+			{
+				scheduler.add(read, readCount);
+			}
+			else
+			{
+				dispatcher.add(read, readCount);
+			}
+			readCount += 1;
 		});
 	}
-	readStreamingFinished = true;
+	if (schedulingWindow > 1) scheduler.finish();
+	dispatcher.finish();
+	if (fileSeeder != nullptr) fileSeeder->finishStreaming();
+	writequeue.close();
 }
 
-void consumeBytesAndWrite(const std::string& filename, moodycamel::ConcurrentQueue<std::string*>& writequeue, moodycamel::ConcurrentQueue<std::string*>& deallocqueue, std::atomic<bool>& allThreadsDone, std::atomic<bool>& allWriteDone, bool verboseMode, bool textMode)
+//output of one read to one output file
+struct OutputItem
+{
+	size_t readNumber;
+	std::string bytes;
+};
+
+//queue from the aligner threads to the writer thread of one output file
+struct OutputQueue
+{
+	OutputQueue(bool enabled, size_t numThreads, size_t maxBytes, size_t reorderWindowSize) :
+	enabled(enabled),
+	queue(100, maxBytes, numThreads, [](OutputItem* const& item) { return sizeof(OutputItem) + item->bytes.size(); }),
+	reorder()
+	{
+		if (reorderWindowSize > 0) reorder = std::make_unique<ReorderWindow>(reorderWindowSize);
+	}
+	~OutputQueue()
+	{
+		OutputItem* item;
+		while (recycled.try_dequeue(item)) delete item;
+	}
+	bool enabled;
+	PipelineQueue<OutputItem*> queue;
+	//null if the items are written in the order they are finished
+	std::unique_ptr<ReorderWindow> reorder;
+	//written items go back to the aligner threads here, so the items and their buffers are allocated only once
+	moodycamel::ConcurrentQueue<OutputItem*> recycled;
+};
+
+//an aligner thread's handle to one output file
+class ThreadOutput
+{
+public:
+	ThreadOutput(OutputQueue& output) :
+	output(output),
+	token(output.queue.rawQueue()),
+	readNumber(0),
+	wroteRead(true)
+	{
+	}
+	void startRead(size_t number)
+	{
+		readNumber = number;
+		wroteRead = false;
+	}
+	//bytes is left empty but keeps the capacity of a buffer the writer is done with, so the caller can fill it again without allocating
+	void write(std::string& bytes)
+	{
+		assert(!wroteRead);
+		if (output.reorder != nullptr) output.reorder->waitForTurn(readNumber);
+		enqueue(bytes);
+		wroteRead = true;
+	}
+	//output which isn't tied to a single read, only in unordered mode
+	void writeChunk(std::string& bytes)
+	{
+		assert(output.reorder == nullptr);
+		enqueue(bytes);
+	}
+	bool ordered() const
+	{
+		return output.reorder != nullptr;
+	}
+	//in ordered mode every read has exactly one item in each output so the writer knows when the read is done
+	void finishRead()
+	{
+		if (output.enabled && output.reorder != nullptr && !wroteRead)
+		{
+			emptyItem.clear();
+			write(emptyItem);
+		}
+		wroteRead = true;
+	}
+private:
+	void enqueue(std::string& bytes)
+	{
+		OutputItem* item = nullptr;
+		if (!output.recycled.try_dequeue(item)) item = new OutputItem;
+		item->readNumber = readNumber;
+		std::swap(item->bytes, bytes);
+		bytes.clear();
+		output.queue.enqueue(token, item);
+	}
+	OutputQueue& output;
+	moodycamel::ProducerToken token;
+	size_t readNumber;
+	bool wroteRead;
+	std::string emptyItem;
+};
+
+//finishes the current read in all outputs however the read's loop iteration ends
+class FinishReadOutputs
+{
+public:
+	FinishReadOutputs(std::vector<ThreadOutput*> outputs) :
+	outputs(outputs)
+	{
+	}
+	~FinishReadOutputs()
+	{
+		for (auto output : outputs) output->finishRead();
+	}
+private:
+	std::vector<ThreadOutput*> outputs;
+};
+
+enum OutputFileType
+{
+	GAMFile,
+	TextFile,
+	//text compressed into BGZF blocks by the aligner threads, or by the writer thread in ordered mode
+	BgzfFile,
+	BinaryAlignmentFile
+};
+
+//writes batches of output items on its own thread while the writer thread collects the next batch.
+//a batch goes to the file with a few large writev calls without copying the items,
+//and the written items go back to the aligner threads for reuse.
+//errors don't end the program here, they are reported to the caller through the return values and error()
+class AsyncItemWriter
+{
+public:
+	AsyncItemWriter(const std::string& filename, moodycamel::ConcurrentQueue<OutputItem*>& recycled) :
+	filename(filename),
+	recycled(recycled),
+	fd(open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)),
+	writing(),
+	hasBatch(false),
+	finished(false),
+	errorMessage(),
+	mutex(),
+	changed(),
+	thread()
+	{
+		if (fd == -1) fail();
+		thread = std::thread { [this]() { run(); } };
+	}
+	AsyncItemWriter(const AsyncItemWriter& other) = delete;
+	AsyncItemWriter& operator=(const AsyncItemWriter& other) = delete;
+	~AsyncItemWriter()
+	{
+		finish();
+		if (fd != -1) ::close(fd);
+	}
+	//waits until the previous batch is written, then takes the items of batch and leaves it empty.
+	//false if an earlier write failed
+	bool write(std::vector<OutputItem*>& batch)
+	{
+		std::unique_lock<std::mutex> lock { mutex };
+		changed.wait(lock, [this]() { return !hasBatch; });
+		assert(!finished);
+		if (errorMessage.size() > 0) return false;
+		std::swap(writing, batch);
+		hasBatch = true;
+		changed.notify_all();
+		return true;
+	}
+	//waits until every batch is written. false if a write failed
+	bool finish()
+	{
+		bool join = false;
+		{
+			std::lock_guard<std::mutex> lock { mutex };
+			if (!finished)
+			{
+				finished = true;
+				join = true;
+				changed.notify_all();
+			}
+		}
+		if (join) thread.join();
+		return !failed();
+	}
+	//only while no batch is being written, that is before the first batch or after finish
+	bool writeDirectly(const std::string& bytes)
+	{
+		if (failed()) return false;
+		return writeAll(bytes.data(), bytes.size());
+	}
+	//finishes and closes the file. some file systems only report write errors when the file is closed
+	bool close()
+	{
+		if (!finish()) return false;
+		int result = ::close(fd);
+		fd = -1;
+		if (result == -1)
+		{
+			fail();
+			return false;
+		}
+		return true;
+	}
+	bool failed()
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		return errorMessage.size() > 0;
+	}
+	std::string error()
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		return errorMessage;
+	}
+private:
+	static constexpr size_t MaxRecycledCapacity = 4 * 1024 * 1024;
+	void run()
+	{
+		std::vector<OutputItem*> batch;
+		std::vector<iovec> parts;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock { mutex };
+				changed.wait(lock, [this]() { return hasBatch || finished; });
+				if (!hasBatch) return;
+				std::swap(batch, writing);
+			}
+			parts.clear();
+			for (auto item : batch)
+			{
+				if (item->bytes.size() == 0) continue;
+				parts.push_back(iovec { (void*)item->bytes.data(), item->bytes.size() });
+			}
+			//after a failed write the caller stops at its next batch, the batches until then are dropped
+			if (!failed()) writeParts(parts);
+			for (auto item : batch)
+			{
+				//don't keep the memory of an unusually big item around
+				if (item->bytes.capacity() > MaxRecycledCapacity) std::string{}.swap(item->bytes);
+				item->bytes.clear();
+			}
+			recycled.enqueue_bulk(batch.data(), batch.size());
+			batch.clear();
+			{
+				std::lock_guard<std::mutex> lock { mutex };
+				hasBatch = false;
+				changed.notify_all();
+			}
+		}
+	}
+	bool writeParts(std::vector<iovec>& parts)
+	{
+		size_t done = 0;
+		while (done < parts.size())
+		{
+			int count = std::min(parts.size() - done, (size_t)IOV_MAX);
+			ssize_t written = writev(fd, parts.data() + done, count);
+			if (written == -1 && errno == EINTR) continue;
+			if (written == -1)
+			{
+				fail();
+				return false;
+			}
+			//a partial write leaves the rest of the parts for the next call
+			while (done < parts.size() && written >= (ssize_t)parts[done].iov_len)
+			{
+				written -= parts[done].iov_len;
+				done++;
+			}
+			if (written > 0)
+			{
+				parts[done].iov_base = (char*)parts[done].iov_base + written;
+				parts[done].iov_len -= written;
+			}
+		}
+		return true;
+	}
+	bool writeAll(const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			ssize_t written = ::write(fd, data, size);
+			if (written == -1 && errno == EINTR) continue;
+			if (written == -1)
+			{
+				fail();
+				return false;
+			}
+			data += written;
+			size -= written;
+		}
+		return true;
+	}
+	//keeps the first error
+	void fail()
+	{
+		std::string message = "Could not write to " + filename + ": " + strerror(errno);
+		std::lock_guard<std::mutex> lock { mutex };
+		if (errorMessage.size() == 0) errorMessage = message;
+	}
+	std::string filename;
+	moodycamel::ConcurrentQueue<OutputItem*>& recycled;
+	int fd;
+	std::vector<OutputItem*> writing;
+	bool hasBatch;
+	bool finished;
+	std::string errorMessage;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::thread thread;
+};
+
+//compresses ordered BGZF output after it has been put in order, so the blocks are full instead of one per read
+OutputItem* compressedItem(OutputQueue& output, std::string& text)
+{
+	OutputItem* item = nullptr;
+	if (!output.recycled.try_dequeue(item)) item = new OutputItem;
+	item->bytes.clear();
+	Bgzf::CompressBlocks(text, item->bytes);
+	text.clear();
+	return item;
+}
+
+[[noreturn]] void writeFailed(AsyncItemWriter& outfile)
+{
+	std::cerr << outfile.error() << std::endl;
+	std::exit(1);
+}
+
+void consumeBytesAndWrite(const std::string& filename, OutputQueue& output, bool verboseMode, OutputFileType fileType)
 {
 	assertSetRead("Writer", "No seed");
-	auto openmode = std::ios::out;
-	if (!textMode) openmode |= std::ios::binary;
-	std::ofstream outfile { filename, openmode };
+	AsyncItemWriter outfile { filename, output.recycled };
+	if (outfile.failed()) writeFailed(outfile);
+
+	if (fileType == BinaryAlignmentFile)
+	{
+		if (!outfile.writeDirectly(BinaryAlignment::FileHeader())) writeFailed(outfile);
+	}
 
 	bool wroteAny = false;
 
-	std::string* alns[100] {};
+	OutputItem* alns[100] {};
+	PipelineQueue<OutputItem*>& writequeue = output.queue;
+	//ordered mode: items wait here until all earlier reads are written. the reorder window guarantees they fit
+	std::vector<OutputItem*> reorderBuffer;
+	if (output.reorder != nullptr) reorderBuffer.resize(output.reorder->size(), nullptr);
+	size_t nextReadNumber = 0;
+	//items are handed to the file writer in batches of at least this many bytes
+	const size_t WriteBatchBytes = 4 * 1024 * 1024;
+	std::vector<OutputItem*> written;
+	size_t writtenBytes = 0;
+	//the empty items of reads without output go straight back to the aligner threads instead of waiting in a batch
+	std::vector<OutputItem*> emptyItems;
+	//ordered BGZF output arrives uncompressed and is collected here until it fills a batch
+	bool compressOrdered = fileType == BgzfFile && output.reorder != nullptr;
+	std::string orderedText;
 
 	BufferedWriter coutoutput;
 	if (verboseMode)
@@ -202,119 +738,272 @@ void consumeBytesAndWrite(const std::string& filename, moodycamel::ConcurrentQue
 
 	while (true)
 	{
-		size_t gotAlns = writequeue.try_dequeue_bulk(alns, 100);
-		if (gotAlns == 0)
+		size_t gotAlns = writequeue.dequeueBulk(alns, 100);
+		if (gotAlns == 0) break;
+		coutoutput << "write " << gotAlns << ", " << writequeue.rawQueue().size_approx() << " left" << BufferedWriter::Flush;
+		size_t oldWrittenCount = written.size();
+		for (size_t i = 0; i < gotAlns; i++)
 		{
-			if (!writequeue.try_dequeue(alns[0]))
+			if (output.reorder == nullptr)
 			{
-				if (allThreadsDone) break;
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				written.push_back(alns[i]);
 				continue;
 			}
-			gotAlns = 1;
+			assert(alns[i]->readNumber >= nextReadNumber);
+			assert(alns[i]->readNumber < nextReadNumber + reorderBuffer.size());
+			size_t slot = alns[i]->readNumber % reorderBuffer.size();
+			assert(reorderBuffer[slot] == nullptr);
+			reorderBuffer[slot] = alns[i];
 		}
-		coutoutput << "write " << gotAlns << ", " << writequeue.size_approx() << " left" << BufferedWriter::Flush;
-		for (size_t i = 0; i < gotAlns; i++)
+		if (output.reorder != nullptr)
+		{
+			while (reorderBuffer[nextReadNumber % reorderBuffer.size()] != nullptr)
+			{
+				OutputItem* item = reorderBuffer[nextReadNumber % reorderBuffer.size()];
+				if (compressOrdered)
+				{
+					orderedText += item->bytes;
+					item->bytes.clear();
+				}
+				if (item->bytes.size() > 0)
+				{
+					written.push_back(item);
+				}
+				else
+				{
+					emptyItems.push_back(item);
+				}
+				reorderBuffer[nextReadNumber % reorderBuffer.size()] = nullptr;
+				nextReadNumber++;
+			}
+			if (compressOrdered && orderedText.size() >= WriteBatchBytes) written.push_back(compressedItem(output, orderedText));
+		}
+		for (size_t i = oldWrittenCount; i < written.size(); i++)
 		{
-			outfile.write(alns[i]->data(), alns[i]->size());
+			writtenBytes += written[i]->bytes.size();
+			if (written[i]->bytes.size() > 0) wroteAny = true;
+		}
+		//the order of the items is fixed now, so the next reads can go ahead while the items wait for the file writer
+		if (output.reorder != nullptr) output.reorder->advance(nextReadNumber);
+		if (emptyItems.size() > 0)
+		{
+			output.recycled.enqueue_bulk(emptyItems.data(), emptyItems.size());
+			emptyItems.clear();
+		}
+		if (writtenBytes >= WriteBatchBytes)
+		{
+			if (!outfile.write(written)) writeFailed(outfile);
+			writtenBytes = 0;
 		}
-		deallocqueue.enqueue_bulk(alns, gotAlns);
-		wroteAny = true;
 	}
+	for (auto item : reorderBuffer) assert(item == nullptr);
+	if (orderedText.size() > 0) written.push_back(compressedItem(output, orderedText));
+	if (written.size() > 0 && !outfile.write(written)) writeFailed(outfile);
+	if (!outfile.finish()) writeFailed(outfile);
 
-	if (!textMode && !wroteAny)
+	if (fileType == BgzfFile)
 	{
-		::google::protobuf::io::ZeroCopyOutputStream *raw_out =
-		      new ::google::protobuf::io::OstreamOutputStream(&outfile);
-		::google::protobuf::io::GzipOutputStream *gzip_out =
-		      new ::google::protobuf::io::GzipOutputStream(raw_out);
-		::google::protobuf::io::CodedOutputStream *coded_out =
-		      new ::google::protobuf::io::CodedOutputStream(gzip_out);
-		coded_out->WriteVarint64(0);
-		delete coded_out;
-		delete gzip_out;
-		delete raw_out;
+		if (!outfile.writeDirectly(Bgzf::EofBlock())) writeFailed(outfile);
 	}
 
-	allWriteDone = true;
+	if (fileType == GAMFile && !wroteAny)
+	{
+		std::string emptyGroup;
+		{
+			::google::protobuf::io::StringOutputStream raw_out { &emptyGroup };
+			::google::protobuf::io::GzipOutputStream gzip_out { &raw_out };
+			{
+				::google::protobuf::io::CodedOutputStream coded_out { &gzip_out };
+				coded_out.WriteVarint64(0);
+			}
+			gzip_out.Close();
+		}
+		if (!outfile.writeDirectly(emptyGroup)) writeFailed(outfile);
+	}
+	if (!outfile.close()) writeFailed(outfile);
 }
 
-void QueueInsertSlowly(moodycamel::ProducerToken& token, moodycamel::ConcurrentQueue<std::string*>& queue, std::string&& str)
+//collects the GAM groups of many reads of one thread and compresses them into one gzip member,
+//instead of setting up a compressor for every read. in ordered mode each read still gets its own member
+class GAMChunkWriter
 {
-	std::string* write = new std::string { std::move(str) };
-	size_t waited = 0;
-	while (!queue.try_enqueue(token, write) && !queue.try_enqueue(token, write))
+public:
+	GAMChunkWriter(ThreadOutput& output) :
+	output(output),
+	uncompressed(),
+	compressed(),
+	message()
+	{
+	}
+	void add(const AlignmentResult& alignments)
 	{
-		if (queue.size_approx() < 100 && queue.enqueue(token, write)) break;
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
-		waited++;
-		if (waited >= 10)
+		for (size_t i = 0; i < alignments.alignments.size(); i++)
+		{
+			assert(!alignments.alignments[i].alignmentFailed());
+			assert(alignments.alignments[i].alignment != nullptr);
+		}
+		{
+			::google::protobuf::io::StringOutputStream raw_out { &uncompressed };
+			::google::protobuf::io::CodedOutputStream coded_out { &raw_out };
+			coded_out.WriteVarint64(alignments.alignments.size());
+			for (size_t i = 0; i < alignments.alignments.size(); i++)
+			{
+				alignments.alignments[i].alignment->SerializeToString(&message);
+				coded_out.WriteVarint32(message.size());
+				coded_out.WriteRaw(message.data(), message.size());
+			}
+		}
+		if (output.ordered())
+		{
+			output.write(compress());
+		}
+		else if (uncompressed.size() >= ChunkSize)
 		{
-			if (queue.enqueue(token, write)) break;
+			output.writeChunk(compress());
 		}
 	}
+	//called when the thread is done
+	void flush()
+	{
+		if (uncompressed.size() == 0) return;
+		output.writeChunk(compress());
+	}
+private:
+	static constexpr size_t ChunkSize = 1024 * 1024;
+	std::string& compress()
+	{
+		compressed.clear();
+		{
+			::google::protobuf::io::StringOutputStream raw_out { &compressed };
+			::google::protobuf::io::GzipOutputStream gzip_out { &raw_out };
+			{
+				::google::protobuf::io::CodedOutputStream coded_out { &gzip_out };
+				coded_out.WriteRaw(uncompressed.data(), uncompressed.size());
+			}
+			gzip_out.Close();
+		}
+		uncompressed.clear();
+		return compressed;
+	}
+	ThreadOutput& output;
+	std::string uncompressed;
+	std::string compressed;
+	std::string message;
+};
+
+void writeGAMToQueue(GAMChunkWriter& alignmentsOut, const AlignerParams& params, const AlignmentResult& alignments)
+{
+	alignmentsOut.add(alignments);
 }
 
-void writeGAMToQueue(moodycamel::ProducerToken& token, const AlignerParams& params, moodycamel::ConcurrentQueue<std::string*>& alignmentsOut, const AlignmentResult& alignments)
+//collects the text or binary output of many reads of one thread into a buffer and hands it to the writer in large chunks.
+//compressed output is cut into BGZF blocks here, so the aligner threads share the compression work.
+//in ordered mode each read gets its own uncompressed item, and the writer thread compresses them after putting them in order
+class OutputChunkWriter
 {
-	std::stringstream strstr;
-	::google::protobuf::io::ZeroCopyOutputStream *raw_out = new ::google::protobuf::io::OstreamOutputStream(&strstr);
-	::google::protobuf::io::GzipOutputStream *gzip_out = new ::google::protobuf::io::GzipOutputStream(raw_out);
-	::google::protobuf::io::CodedOutputStream *coded_out = new ::google::protobuf::io::CodedOutputStream(gzip_out);
-	coded_out->WriteVarint64(alignments.alignments.size());
-	for (size_t i = 0; i < alignments.alignments.size(); i++)
+public:
+	OutputChunkWriter(ThreadOutput& output, bool compressed) :
+	output(output),
+	compressed(compressed),
+	uncompressed(),
+	compressedBytes()
 	{
-		assert(!alignments.alignments[i].alignmentFailed());
-		assert(alignments.alignments[i].alignment != nullptr);
-		std::string s;
-		alignments.alignments[i].alignment->SerializeToString(&s);
-		coded_out->WriteVarint32(s.size());
-		coded_out->WriteRaw(s.data(), s.size());
-	}
-	delete coded_out;
-	delete gzip_out;
-	delete raw_out;
-	QueueInsertSlowly(token, alignmentsOut, strstr.str());
-}
+	}
+	//the current read's output is appended here
+	std::string& buffer()
+	{
+		return uncompressed;
+	}
+	void finishRead()
+	{
+		if (output.ordered())
+		{
+			output.write(take());
+		}
+		else if (uncompressed.size() >= ChunkSize)
+		{
+			output.writeChunk(take());
+		}
+	}
+	//called when the thread is done
+	void flush()
+	{
+		if (uncompressed.size() == 0) return;
+		output.writeChunk(take());
+	}
+private:
+	static constexpr size_t ChunkSize = 1024 * 1024;
+	std::string& take()
+	{
+		if (!compressed || output.ordered()) return uncompressed;
+		compressedBytes.clear();
+		Bgzf::CompressBlocks(uncompressed, compressedBytes);
+		uncompressed.clear();
+		return compressedBytes;
+	}
+	ThreadOutput& output;
+	bool compressed;
+	std::string uncompressed;
+	std::string compressedBytes;
+};
 
-void writeJSONToQueue(moodycamel::ProducerToken& token, const AlignerParams& params, moodycamel::ConcurrentQueue<std::string*>& alignmentsOut, const AlignmentResult& alignments)
+//formats the JSON lines into the thread's buffer. protobuf's printer goes through reflection, so it's only used for the alignments the direct formatter can't write
+void writeJSONToQueue(OutputChunkWriter& alignmentsOut, const AlignmentResult& alignments)
 {
-	std::stringstream strstr;
-	google::protobuf::util::JsonPrintOptions options;
-	options.preserve_proto_field_names = true;
+	std::string& buffer = alignmentsOut.buffer();
 	for (size_t i = 0; i < alignments.alignments.size(); i++)
 	{
 		assert(!alignments.alignments[i].alignmentFailed());
 		assert(alignments.alignments[i].alignment != nullptr);
-		std::string s;
-		google::protobuf::util::MessageToJsonString(*alignments.alignments[i].alignment, &s, options);
-		strstr << s;
-		strstr << '\n';
+		if (!CommonUtils::AppendAlignmentJSON(buffer, *alignments.alignments[i].alignment))
+		{
+			google::protobuf::util::JsonPrintOptions options;
+			options.preserve_proto_field_names = true;
+			std::string s;
+			google::protobuf::util::MessageToJsonString(*alignments.alignments[i].alignment, &s, options);
+			buffer += s;
+		}
+		buffer += '\n';
 	}
-	QueueInsertSlowly(token, alignmentsOut, strstr.str());
+	alignmentsOut.finishRead();
 }
 
-void writeGAFToQueue(moodycamel::ProducerToken& token, const AlignerParams& params, moodycamel::ConcurrentQueue<std::string*>& alignmentsOut, const AlignmentResult& alignments)
+void writeBinaryToQueue(OutputChunkWriter& alignmentsOut, const FastQ& read, const AlignmentResult& alignments)
 {
-	std::stringstream strstr;
+	std::string& buffer = alignmentsOut.buffer();
 	for (size_t i = 0; i < alignments.alignments.size(); i++)
 	{
 		assert(!alignments.alignments[i].alignmentFailed());
-		assert(alignments.alignments[i].alignment != nullptr);
-		strstr << alignments.alignments[i].GAFline;
-		strstr << '\n';
+		AppendBinaryRecord(read.seq_id, alignments.alignments[i], buffer);
 	}
-	QueueInsertSlowly(token, alignmentsOut, strstr.str());
+	alignmentsOut.finishRead();
 }
 
-void writeCorrectedToQueue(moodycamel::ProducerToken& token, const AlignerParams& params, const std::string& readName, const std::string& original, size_t maxOverlap, moodycamel::ConcurrentQueue<std::string*>& correctedOut, const AlignmentResult& alignments)
+//formats the GAF lines straight from the traces into the thread's buffer
+void writeGAFToQueue(OutputChunkWriter& alignmentsOut, const AlignmentGraph& graph, const FastQ& read, const AlignmentResult& alignments)
 {
-	std::stringstream strstr;
-	zstr::ostream *compressed;
-	if (params.compressCorrected)
+	std::string& buffer = alignmentsOut.buffer();
+	size_t oldSize = buffer.size();
+	try
 	{
-		compressed = new zstr::ostream(strstr);
+		for (size_t i = 0; i < alignments.alignments.size(); i++)
+		{
+			assert(!alignments.alignments[i].alignmentFailed());
+			AppendGAFLine(graph, read.seq_id, read.sequence, alignments.alignments[i], buffer);
+			buffer += '\n';
+		}
 	}
+	catch (const ThreadReadAssertion::AssertionFailure& a)
+	{
+		//don't leave half of the read's lines in the buffer
+		buffer.resize(oldSize);
+		throw;
+	}
+	alignmentsOut.finishRead();
+}
+
+void writeCorrectedToQueue(OutputChunkWriter& correctedOut, const AlignerParams& params, const std::string& readName, const std::string& original, size_t maxOverlap, const AlignmentResult& alignments)
+{
 	std::vector<Correction> corrections;
 	for (size_t i = 0; i < alignments.alignments.size(); i++)
 	{
@@ -325,58 +1014,73 @@ void writeCorrectedToQueue(moodycamel::ProducerToken& token, const AlignerParams
 		corrections.back().endIndex = alignments.alignments[i].alignmentEnd;
 		corrections.back().corrected = alignments.alignments[i].corrected;
 	}
-	std::string corrected = getCorrected(original, corrections, maxOverlap);
-	if (params.compressCorrected)
+	std::string& buffer = correctedOut.buffer();
+	size_t oldSize = buffer.size();
+	try
 	{
-		(*compressed) << ">" << readName << std::endl;
-		(*compressed) << corrected << std::endl;
-		delete compressed;
+		buffer += '>';
+		buffer += readName;
+		buffer += '\n';
+		appendCorrected(buffer, original, corrections, maxOverlap);
+		buffer += '\n';
 	}
-	else
+	catch (const ThreadReadAssertion::AssertionFailure& a)
 	{
-		strstr << ">" << readName << std::endl;
-		strstr << corrected << std::endl;
+		buffer.resize(oldSize);
+		throw;
 	}
-	QueueInsertSlowly(token, correctedOut, strstr.str());
+	correctedOut.finishRead();
 }
 
-void writeCorrectedClippedToQueue(moodycamel::ProducerToken& token, const AlignerParams& params, moodycamel::ConcurrentQueue<std::string*>& correctedClippedOut, const AlignmentResult& alignments)
+void writeCorrectedClippedToQueue(OutputChunkWriter& correctedClippedOut, const AlignerParams& params, const AlignmentResult& alignments)
 {
-	std::stringstream strstr;
-	zstr::ostream *compressed;
-	if (params.compressClipped)
-	{
-		compressed = new zstr::ostream(strstr);
-	}
-	for (size_t i = 0; i < alignments.alignments.size(); i++)
+	std::string& buffer = correctedClippedOut.buffer();
+	size_t oldSize = buffer.size();
+	try
 	{
-		assert(!alignments.alignments[i].alignmentFailed());
-		assert(alignments.alignments[i].corrected.size() > 0);
-		if (params.compressClipped)
-		{
-			(*compressed) << ">" << alignments.readName << "_" << i << "_" << alignments.alignments[i].alignmentStart << "_" << alignments.alignments[i].alignmentEnd << std::endl;
-			(*compressed) << alignments.alignments[i].corrected << std::endl;
-		}
-		else
+		for (size_t i = 0; i < alignments.alignments.size(); i++)
 		{
-			strstr << ">" << alignments.readName << "_" << i << "_" << alignments.alignments[i].alignmentStart << "_" << alignments.alignments[i].alignmentEnd << std::endl;
-			strstr << alignments.alignments[i].corrected << std::endl;
+			assert(!alignments.alignments[i].alignmentFailed());
+			assert(alignments.alignments[i].corrected.size() > 0);
+			buffer += '>';
+			buffer += alignments.readName;
+			buffer += '_';
+			CommonUtils::AppendNumber(buffer, i);
+			buffer += '_';
+			CommonUtils::AppendNumber(buffer, alignments.alignments[i].alignmentStart);
+			buffer += '_';
+			CommonUtils::AppendNumber(buffer, alignments.alignments[i].alignmentEnd);
+			buffer += '\n';
+			buffer += alignments.alignments[i].corrected;
+			buffer += '\n';
 		}
 	}
-	if (params.compressClipped)
+	catch (const ThreadReadAssertion::AssertionFailure& a)
 	{
-		delete compressed;
+		buffer.resize(oldSize);
+		throw;
 	}
-	QueueInsertSlowly(token, correctedClippedOut, strstr.str());
+	correctedClippedOut.finishRead();
 }
 
-void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::ConcurrentQueue<std::shared_ptr<FastQ>>& readFastqsQueue, std::atomic<bool>& readStreamingFinished, int threadnum, const Seeder& seeder, AlignerParams params, moodycamel::ConcurrentQueue<std::string*>& GAMOut, moodycamel::ConcurrentQueue<std::string*>& JSONOut, moodycamel::ConcurrentQueue<std::string*>& GAFOut, moodycamel::ConcurrentQueue<std::string*>& correctedOut, moodycamel::ConcurrentQueue<std::string*>& correctedClippedOut, moodycamel::ConcurrentQueue<std::string*>& deallocqueue, AlignmentStats& stats)
+void runComponentMappings(const AlignmentGraph& alignmentGraph, PipelineQueue<ReadBatch*>& readFastqsQueue, moodycamel::ConcurrentQueue<ReadBatch*>& recycledBatches, int threadnum, const Seeder& seeder, AlignerParams params, OutputQueue& GAMQueue, OutputQueue& JSONQueue, OutputQueue& GAFQueue, OutputQueue& binaryQueue, OutputQueue& correctedQueue, OutputQueue& correctedClippedQueue, AlignmentTaskPool* taskPool, AlignmentStats& stats)
 {
-	moodycamel::ProducerToken GAMToken { GAMOut };
-	moodycamel::ProducerToken JSONToken { JSONOut };
-	moodycamel::ProducerToken GAFToken { GAFOut };
-	moodycamel::ProducerToken correctedToken { correctedOut };
-	moodycamel::ProducerToken clippedToken { correctedClippedOut };
+	ThreadOutput GAMOut { GAMQueue };
+	ThreadOutput JSONOut { JSONQueue };
+	ThreadOutput GAFOut { GAFQueue };
+	ThreadOutput binaryOut { binaryQueue };
+	ThreadOutput correctedOut { correctedQueue };
+	ThreadOutput correctedClippedOut { correctedClippedQueue };
+	GAMChunkWriter GAMChunks { GAMOut };
+	OutputChunkWriter JSONChunks { JSONOut, false };
+	OutputChunkWriter GAFChunks { GAFOut, params.compressGAF };
+	OutputChunkWriter binaryChunks { binaryOut, false };
+	OutputChunkWriter correctedChunks { correctedOut, params.compressCorrected };
+	OutputChunkWriter correctedClippedChunks { correctedClippedOut, params.compressClipped };
+	moodycamel::ConsumerToken readToken { readFastqsQueue.rawQueue() };
+	ReadBatch* batch = nullptr;
+	size_t readIndex = 0;
+	FastQ fastq;
 	assertSetRead("Before any read", "No seed");
 	GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState reusableState { alignmentGraph, std::max(params.initialBandwidth, params.rampBandwidth), !params.highMemory };
 	BufferedWriter cerroutput;
@@ -386,25 +1090,48 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 		cerroutput = {std::cerr};
 		coutoutput = {std::cout};
 	}
+	//the protobuf alignments of a read are built in the arena and freed all at once before the next read.
+	//the first block is kept over the resets, so usually a read doesn't allocate anything for them
+	std::vector<char> arenaBlock;
+	arenaBlock.resize(256 * 1024);
+	google::protobuf::ArenaOptions arenaOptions;
+	arenaOptions.initial_block = arenaBlock.data();
+	arenaOptions.initial_block_size = arenaBlock.size();
+	google::protobuf::Arena alignmentArena { arenaOptions };
 	while (true)
 	{
-		std::string* dealloc;
-		while (deallocqueue.try_dequeue(dealloc))
+		//the previous read's alignments are gone and its output is serialized
+		alignmentArena.Reset();
+		//long reads of other threads go first so they don't hold up the end of the run
+		if (taskPool != nullptr) while (taskPool->tryHelp(reusableState));
+		if (batch != nullptr && readIndex == batch->size())
 		{
-			delete dealloc;
+			recycledBatches.enqueue(batch);
+			batch = nullptr;
 		}
-		std::shared_ptr<FastQ> fastq = nullptr;
-		while (fastq == nullptr && !readFastqsQueue.try_dequeue(fastq))
+		if (batch == nullptr)
 		{
-			bool tryBreaking = readStreamingFinished;
-			if (!readFastqsQueue.try_dequeue(fastq) && tryBreaking) break;
-			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			if (!readFastqsQueue.dequeue(readToken, batch))
+			{
+				if (taskPool != nullptr) taskPool->helpUntilAllFinished(reusableState);
+				break;
+			}
+			readIndex = 0;
 		}
-		if (fastq == nullptr) break;
-		assertSetRead(fastq->seq_id, "No seed");
-		coutoutput << "Read " << fastq->seq_id << " size " << fastq->sequence.size() << "bp" << BufferedWriter::Flush;
+		batch->getRead(readIndex, fastq);
+		size_t readNumber = batch->readNumbers[readIndex];
+		readIndex++;
+		GAMOut.startRead(readNumber);
+		JSONOut.startRead(readNumber);
+		GAFOut.startRead(readNumber);
+		binaryOut.startRead(readNumber);
+		correctedOut.startRead(readNumber);
+		correctedClippedOut.startRead(readNumber);
+		FinishReadOutputs finishOutputs { { &GAMOut, &JSONOut, &GAFOut, &binaryOut, &correctedOut, &correctedClippedOut } };
+		assertSetRead(fastq.seq_id, "No seed");
+		coutoutput << "Read " << fastq.seq_id << " size " << fastq.sequence.size() << "bp" << BufferedWriter::Flush;
 		stats.reads += 1;
-		stats.bpInReads += fastq->sequence.size();
+		stats.bpInReads += fastq.sequence.size();
 
 		AlignmentResult alignments;
 
@@ -413,34 +1140,35 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 			if (seeder.mode != Seeder::Mode::None)
 			{
 				auto timeStart = std::chrono::system_clock::now();
-				std::vector<SeedHit> seeds = seeder.getSeeds(fastq->seq_id, fastq->sequence);
+				std::vector<SeedHit> seeds = seeder.getSeeds(fastq.seq_id, fastq.sequence);
 				auto timeEnd = std::chrono::system_clock::now();
 				size_t time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
-				coutoutput << "Read " << fastq->seq_id << " seeding took " << time << "ms" << BufferedWriter::Flush;
+				coutoutput << "Read " << fastq.seq_id << " seeding took " << time << "ms" << BufferedWriter::Flush;
 				stats.seeds += seeds.size();
 				if (seeds.size() == 0)
 				{
-					coutoutput << "Read " << fastq->seq_id << " has no seed hits" << BufferedWriter::Flush;
-					cerroutput << "Read " << fastq->seq_id << " has no seed hits" << BufferedWriter::Flush;
-					coutoutput << "Read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
-					cerroutput << "Read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
-					if (params.outputCorrectedFile != "") writeCorrectedToQueue(correctedToken, params, fastq->seq_id, fastq->sequence, alignmentGraph.getDBGoverlap(), correctedOut, alignments);
+					coutoutput << "Read " << fastq.seq_id << " has no seed hits" << BufferedWriter::Flush;
+					cerroutput << "Read " << fastq.seq_id << " has no seed hits" << BufferedWriter::Flush;
+					coutoutput << "Read " << fastq.seq_id << " alignment failed" << BufferedWriter::Flush;
+					cerroutput << "Read " << fastq.seq_id << " alignment failed" << BufferedWriter::Flush;
+					if (params.outputCorrectedFile != "") writeCorrectedToQueue(correctedChunks, params, fastq.seq_id, fastq.sequence, alignmentGraph.getDBGoverlap(), alignments);
 					continue;
 				}
 				stats.seedsFound += seeds.size();
 				stats.readsWithASeed += 1;
-				stats.bpInReadsWithASeed += fastq->sequence.size();
-				alignments = AlignOneWay(alignmentGraph, fastq->seq_id, fastq->sequence, params.initialBandwidth, params.rampBandwidth, params.maxCellsPerSlice, !params.verboseMode, !params.tryAllSeeds, seeds, reusableState, !params.highMemory, params.forceGlobal, params.preciseClipping);
+				stats.bpInReadsWithASeed += fastq.sequence.size();
+				AlignmentTaskPool* readTaskPool = fastq.sequence.size() >= params.parallelExtensionLength ? taskPool : nullptr;
+				alignments = AlignOneWay(alignmentGraph, fastq.seq_id, fastq.sequence, params.initialBandwidth, params.rampBandwidth, params.maxCellsPerSlice, !params.verboseMode, !params.tryAllSeeds, seeds, reusableState, !params.highMemory, params.forceGlobal, params.preciseClipping, readTaskPool);
 			}
 			else
 			{
-				alignments = AlignOneWay(alignmentGraph, fastq->seq_id, fastq->sequence, params.initialBandwidth, params.rampBandwidth, !params.verboseMode, reusableState, !params.highMemory, params.forceGlobal, params.preciseClipping);
+				alignments = AlignOneWay(alignmentGraph, fastq.seq_id, fastq.sequence, params.initialBandwidth, params.rampBandwidth, !params.verboseMode, reusableState, !params.highMemory, params.forceGlobal, params.preciseClipping);
 			}
 		}
 		catch (const ThreadReadAssertion::AssertionFailure& a)
 		{
-			coutoutput << "Read " << fastq->seq_id << " alignment failed (assertion!)" << BufferedWriter::Flush;
-			cerroutput << "Read " << fastq->seq_id << " alignment failed (assertion!)" << BufferedWriter::Flush;
+			coutoutput << "Read " << fastq.seq_id << " alignment failed (assertion!)" << BufferedWriter::Flush;
+			cerroutput << "Read " << fastq.seq_id << " alignment failed (assertion!)" << BufferedWriter::Flush;
 			reusableState.clear();
 			stats.assertionBroke = true;
 			continue;
@@ -449,11 +1177,11 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 		//failed alignment, don't output
 		if (alignments.alignments.size() == 0)
 		{
-			coutoutput << "Read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
-			cerroutput << "Read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
+			coutoutput << "Read " << fastq.seq_id << " alignment failed" << BufferedWriter::Flush;
+			cerroutput << "Read " << fastq.seq_id << " alignment failed" << BufferedWriter::Flush;
 			try
 			{
-				if (params.outputCorrectedFile != "") writeCorrectedToQueue(correctedToken, params, fastq->seq_id, fastq->sequence, alignmentGraph.getDBGoverlap(), correctedOut, alignments);
+				if (params.outputCorrectedFile != "") writeCorrectedToQueue(correctedChunks, params, fastq.seq_id, fastq.sequence, alignmentGraph.getDBGoverlap(), alignments);
 			}
 			catch (const ThreadReadAssertion::AssertionFailure& a)
 			{
@@ -467,29 +1195,26 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 		stats.seedsExtended += alignments.seedsExtended;
 		stats.readsWithAnAlignment += 1;
 
-		if (params.outputGAMFile != "" || params.outputJSONFile != "" || !params.outputAllAlns)
+		if (!params.outputAllAlns)
 		{
-			for (size_t i = 0; i < alignments.alignments.size(); i++)
-			{
-				AddAlignment(fastq->seq_id, fastq->sequence, alignments.alignments[i]);
-				replaceDigraphNodeIdsWithOriginalNodeIds(*alignments.alignments[i].alignment, alignmentGraph);
-			}
+			alignments.alignments = CommonUtils::SelectAlignments(alignments.alignments, std::numeric_limits<size_t>::max(),
+				[](const AlignmentResult::AlignmentItem& aln) { return aln.alignmentStart; },
+				[](const AlignmentResult::AlignmentItem& aln) { return aln.alignmentEnd; },
+				[](const AlignmentResult::AlignmentItem& aln) { return aln.trace->score; });
 		}
-		if (params.outputGAFFile != "")
+		
+		std::sort(alignments.alignments.begin(), alignments.alignments.end(), [](const AlignmentResult::AlignmentItem& left, const AlignmentResult::AlignmentItem& right) { return left.alignmentStart < right.alignmentStart; });
+
+		//the protobuf alignments are only needed for writing them, GAF and corrected output work from the trace
+		if (params.outputGAMFile != "" || params.outputJSONFile != "")
 		{
 			for (size_t i = 0; i < alignments.alignments.size(); i++)
 			{
-				AddGAFLine(alignmentGraph, fastq->seq_id, fastq->sequence, alignments.alignments[i]);
+				AddAlignment(fastq.seq_id, fastq.sequence, alignments.alignments[i], &alignmentArena);
+				replaceDigraphNodeIdsWithOriginalNodeIds(*alignments.alignments[i].alignment, alignmentGraph);
 			}
 		}
 
-		if (!params.outputAllAlns)
-		{
-			alignments.alignments = CommonUtils::SelectAlignments(alignments.alignments, std::numeric_limits<size_t>::max(), [](const AlignmentResult::AlignmentItem& aln) { return aln.alignment.get(); });
-		}
-		
-		std::sort(alignments.alignments.begin(), alignments.alignments.end(), [](const AlignmentResult::AlignmentItem& left, const AlignmentResult::AlignmentItem& right) { return left.alignmentStart < right.alignmentStart; });
-
 		std::string alignmentpositions;
 		size_t timems = 0;
 		size_t totalcells = 0;
@@ -497,13 +1222,14 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 		for (size_t i = 0; i < alignments.alignments.size(); i++)
 		{
 			stats.alignments += 1;
-			if (alignments.alignments[i].alignment->sequence().size() == fastq->sequence.size())
+			size_t alignmentLength = alignments.alignments[i].alignmentEnd - alignments.alignments[i].alignmentStart;
+			if (alignmentLength == fastq.sequence.size())
 			{
 				stats.fullLengthAlignments += 1;
-				stats.bpInFullAlignments += alignments.alignments[i].alignment->sequence().size();
+				stats.bpInFullAlignments += alignmentLength;
 			}
-			stats.bpInAlignments += alignments.alignments[i].alignment->sequence().size();
-			if (params.outputCorrectedFile != "" || params.outputCorrectedClippedFile != "") AddCorrected(alignments.alignments[i]);
+			stats.bpInAlignments += alignmentLength;
+			if (params.outputCorrectedFile != "" || params.outputCorrectedClippedFile != "") AddCorrected(alignmentGraph, alignments.alignments[i]);
 			alignmentpositions += std::to_string(alignments.alignments[i].alignmentStart) + "-" + std::to_string(alignments.alignments[i].alignmentEnd) + ", ";
 			timems += alignments.alignments[i].elapsedMilliseconds;
 			totalcells += alignments.alignments[i].cellsProcessed;
@@ -511,16 +1237,17 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 
 		alignmentpositions.pop_back();
 		alignmentpositions.pop_back();
-		coutoutput << "Read " << fastq->seq_id << " alignment took " << timems << "ms" << BufferedWriter::Flush;
-		coutoutput << "Read " << fastq->seq_id << " aligned by thread " << threadnum << " with positions: " << alignmentpositions << " (read " << fastq->sequence.size() << "bp)" << BufferedWriter::Flush;
+		coutoutput << "Read " << fastq.seq_id << " alignment took " << timems << "ms" << BufferedWriter::Flush;
+		coutoutput << "Read " << fastq.seq_id << " aligned by thread " << threadnum << " with positions: " << alignmentpositions << " (read " << fastq.sequence.size() << "bp)" << BufferedWriter::Flush;
 
 		try
 		{
-			if (params.outputGAMFile != "") writeGAMToQueue(GAMToken, params, GAMOut, alignments);
-			if (params.outputJSONFile != "") writeJSONToQueue(JSONToken, params, JSONOut, alignments);
-			if (params.outputGAFFile != "") writeGAFToQueue(GAFToken, params, GAFOut, alignments);
-			if (params.outputCorrectedFile != "") writeCorrectedToQueue(correctedToken, params, fastq->seq_id, fastq->sequence, alignmentGraph.getDBGoverlap(), correctedOut, alignments);
-			if (params.outputCorrectedClippedFile != "") writeCorrectedClippedToQueue(clippedToken, params, correctedClippedOut, alignments);
+			if (params.outputGAMFile != "") writeGAMToQueue(GAMChunks, params, alignments);
+			if (params.outputJSONFile != "") writeJSONToQueue(JSONChunks, alignments);
+			if (params.outputGAFFile != "") writeGAFToQueue(GAFChunks, alignmentGraph, fastq, alignments);
+			if (params.outputBinaryFile != "") writeBinaryToQueue(binaryChunks, fastq, alignments);
+			if (params.outputCorrectedFile != "") writeCorrectedToQueue(correctedChunks, params, fastq.seq_id, fastq.sequence, alignmentGraph.getDBGoverlap(), alignments);
+			if (params.outputCorrectedClippedFile != "") writeCorrectedClippedToQueue(correctedClippedChunks, params, alignments);
 		}
 		catch (const ThreadReadAssertion::AssertionFailure& a)
 		{
@@ -530,6 +1257,12 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 		}
 
 	}
+	GAMChunks.flush();
+	JSONChunks.flush();
+	GAFChunks.flush();
+	binaryChunks.flush();
+	correctedChunks.flush();
+	correctedClippedChunks.flush();
 	assertSetRead("After all reads", "No seed");
 	coutoutput << "Thread " << threadnum << " finished" << BufferedWriter::Flush;
 }
@@ -555,7 +1288,7 @@ AlignmentGraph getGraph(std::string graphFile, MummerSeeder** mxmSeeder, const A
 				if (loadMxmSeeder)
 				{
 					std::cout << "Build MUM/MEM seeder from the graph" << std::endl;
-					*mxmSeeder = new MummerSeeder { graph, params.seederCachePrefix };
+					*mxmSeeder = new MummerSeeder { graph, params.seederCachePrefix, params.mxmSparseness };
 				}
 				std::cout << "Build alignment graph" << std::endl;
 				auto result = DirectedGraph::BuildFromVG(graph, tryDAG);
@@ -572,7 +1305,7 @@ AlignmentGraph getGraph(std::string graphFile, MummerSeeder** mxmSeeder, const A
 			if (loadMxmSeeder)
 			{
 				std::cout << "Build MUM/MEM seeder from the graph" << std::endl;
-				*mxmSeeder = new MummerSeeder { graph, params.seederCachePrefix };
+				*mxmSeeder = new MummerSeeder { graph, params.seederCachePrefix, params.mxmSparseness };
 			}
 			std::cout << "Build alignment graph" << std::endl;
 			auto result = DirectedGraph::BuildFromGFA(graph, tryDAG);
@@ -596,47 +1329,98 @@ void alignReads(AlignerParams params)
 {
 	assertSetRead("Preprocessing", "No seed");
 
-	const std::unordered_map<std::string, std::vector<SeedHit>>* seedHitsToThreads = nullptr;
-	std::unordered_map<std::string, std::vector<SeedHit>> seedHits;
+	FileSeeder* fileseeder = nullptr;
 	MummerSeeder* mummerseeder = nullptr;
+	std::vector<std::vector<int>> numaNodeCpus;
+	if (params.numaMode != "off")
+	{
+		numaNodeCpus = Numa::NodeCpus();
+		if (numaNodeCpus.size() < 2)
+		{
+			std::cout << "Only one NUMA node, ignoring --numa" << std::endl;
+			numaNodeCpus.clear();
+		}
+		else
+		{
+			std::cout << numaNodeCpus.size() << " NUMA nodes, aligner threads are split evenly between them" << std::endl;
+			//the graph and the seed indices are read by threads on every node, so spread them instead of placing them all on the node of the loading thread
+			if (!Numa::InterleaveAllocations(Numa::NodeIds())) std::cerr << "Could not interleave memory over the NUMA nodes" << std::endl;
+		}
+	}
 	auto alignmentGraph = getGraph(params.graphFile, &mummerseeder, params);
 	bool loadMinimizerSeeder = params.minimizerCount > 0;
 	MinimizerSeeder* minimizerseeder = nullptr;
 	if (loadMinimizerSeeder)
 	{
 		std::cout << "Build minimizer seeder from the graph" << std::endl;
-		minimizerseeder = new MinimizerSeeder(alignmentGraph, params.minimizerLength, params.minimizerWindowSize, params.numThreads);
+		minimizerseeder = new MinimizerSeeder(alignmentGraph, params.minimizerLength, params.minimizerWindowSize, 0, params.numThreads, params.minimizerSpanEdges);
+	}
+	if (params.syncmerCount > 0)
+	{
+		std::cout << "Build syncmer seeder from the graph" << std::endl;
+		minimizerseeder = new MinimizerSeeder(alignmentGraph, params.syncmerLength, params.syncmerLength, params.syncmerSmerLength, params.numThreads, params.minimizerSpanEdges);
+	}
+	if (minimizerseeder != nullptr && minimizerseeder->getTruncatedWalkNodes() > 0)
+	{
+		std::cerr << minimizerseeder->getTruncatedWalkNodes() << " nodes have too many paths over their out-edges, some of the minimizers spanning those edges are not indexed" << std::endl;
 	}
 
 	if (params.seedFiles.size() > 0)
 	{
 		for (auto file : params.seedFiles)
 		{
-			if (is_file_exist(file)){
-				std::cout << "Load seeds from " << file << std::endl;
-				std::ifstream seedfile { file, std::ios::in | std::ios::binary };
-				size_t numSeeds = 0;
-				std::function<void(vg::Alignment&)> alignmentLambda = [&seedHits, &numSeeds](vg::Alignment& seedhit) {
-					seedHits[seedhit.name()].emplace_back(seedhit.path().mapping(0).position().node_id(), seedhit.path().mapping(0).position().offset(), seedhit.query_position(), seedhit.path().mapping(0).edit(0).from_length(), seedhit.path().mapping(0).position().is_reverse());
-					numSeeds += 1;
-				};
-				stream::for_each(seedfile, alignmentLambda);
-				std::cout << numSeeds << " seeds" << std::endl;
-			}
-			else {
+			if (!is_file_exist(file))
+			{
 				std::cerr << "No seeds file exists" << std::endl;
 				std::exit(0);
 			}
 		}
-		seedHitsToThreads = &seedHits;
+		if (params.seedFilesStreaming)
+		{
+			std::cout << "Stream seeds from";
+			for (auto file : params.seedFiles) std::cout << " " << file;
+			std::cout << std::endl;
+		}
+		else
+		{
+			std::cout << "Load seeds from";
+			for (auto file : params.seedFiles) std::cout << " " << file;
+			std::cout << std::endl;
+		}
+		fileseeder = new FileSeeder(params.seedFiles, params.seedFilesStreaming);
+		if (!params.seedFilesStreaming) std::cout << fileseeder->numSeeds() << " seeds" << std::endl;
 	}
 
-	Seeder seeder { params, seedHitsToThreads, mummerseeder, minimizerseeder };
+	Seeder seeder { params, fileseeder, mummerseeder, minimizerseeder };
+
+	std::vector<std::unique_ptr<AlignmentGraph>> graphReplicas;
+	if (numaNodeCpus.size() > 0)
+	{
+		//from here on allocations are local to the thread which makes them, including each aligner thread's own state
+		Numa::DefaultAllocations();
+		if (params.numaMode == "replicate")
+		{
+			std::cout << "Copy the alignment graph to each NUMA node" << std::endl;
+			graphReplicas.resize(numaNodeCpus.size());
+			std::vector<std::thread> copyThreads;
+			for (size_t i = 0; i < numaNodeCpus.size(); i++)
+			{
+				copyThreads.emplace_back([&graphReplicas, &numaNodeCpus, &alignmentGraph, i]()
+				{
+					Numa::PinThread(numaNodeCpus[i]);
+					graphReplicas[i] = std::make_unique<AlignmentGraph>(alignmentGraph);
+				});
+			}
+			for (auto& thread : copyThreads) thread.join();
+		}
+	}
 
 	switch(seeder.mode)
 	{
 		case Seeder::Mode::File:
-			std::cout << "Seeds from file" << std::endl;
+			std::cout << "Seeds from file";
+			if (params.seedFilesStreaming) std::cout << ", streamed in read order";
+			std::cout << std::endl;
 			break;
 		case Seeder::Mode::Mum:
 			std::cout << "MUM seeds, min length " << seeder.mxmLength << ", max count " << seeder.mumCount << std::endl;
@@ -645,7 +1429,14 @@ void alignReads(AlignerParams params)
 			std::cout << "MEM seeds, min length " << seeder.mxmLength << ", max count " << seeder.memCount << std::endl;
 			break;
 		case Seeder::Mode::Minimizer:
-			std::cout << "Minimizer seeds, length " << seeder.minimizerLength << ", window size " << seeder.minimizerWindowSize << ", per chunk count " << seeder.minimizerCount << ", chunk size " << seeder.minimizerChunkSize << std::endl;
+			std::cout << "Minimizer seeds, length " << seeder.minimizerLength << ", window size " << seeder.minimizerWindowSize << ", per chunk count " << seeder.minimizerCount << ", chunk size " << seeder.minimizerChunkSize;
+			if (params.minimizerSpanEdges) std::cout << ", spanning edges";
+			std::cout << std::endl;
+			break;
+		case Seeder::Mode::Syncmer:
+			std::cout << "Closed syncmer seeds, length " << seeder.syncmerLength << ", s-mer length " << seeder.syncmerSmerLength << ", per chunk count " << seeder.syncmerCount << ", chunk size " << seeder.syncmerChunkSize;
+			if (params.minimizerSpanEdges) std::cout << ", spanning edges";
+			std::cout << std::endl;
 			break;
 		case Seeder::Mode::None:
 			std::cout << "No seeds, calculate the entire first row. VERY SLOW!" << std::endl;
@@ -656,10 +1447,14 @@ void alignReads(AlignerParams params)
 	if (params.rampBandwidth > 0) std::cout << ", ramp bandwidth " << params.rampBandwidth;
 	if (params.maxCellsPerSlice != std::numeric_limits<size_t>::max()) std::cout << ", tangle effort " << params.maxCellsPerSlice;
 	std::cout << std::endl;
+	if (params.parallelExtensionLength > 0) std::cout << "Extend seeds of reads longer than " << params.parallelExtensionLength << "bp with several threads" << std::endl;
 
+	if (params.schedulingWindow > 1) std::cout << "Align the longest reads first in windows of " << params.schedulingWindow << " reads" << std::endl;
+	if (params.orderedOutput) std::cout << "Output in input order" << std::endl;
 	if (params.outputGAMFile != "") std::cout << "write alignments to " << params.outputGAMFile << std::endl;
 	if (params.outputJSONFile != "") std::cout << "write alignments to " << params.outputJSONFile << std::endl;
 	if (params.outputGAFFile != "") std::cout << "write alignments to " << params.outputGAFFile << std::endl;
+	if (params.outputBinaryFile != "") std::cout << "write alignments to " << params.outputBinaryFile << std::endl;
 	if (params.outputCorrectedFile != "") std::cout << "write corrected reads to " << params.outputCorrectedFile << std::endl;
 	if (params.outputCorrectedClippedFile != "") std::cout << "write corrected & clipped reads to " << params.outputCorrectedClippedFile << std::endl;
 
@@ -667,33 +1462,54 @@ void alignReads(AlignerParams params)
 
 	assertSetRead("Running alignments", "No seed");
 
-	moodycamel::ConcurrentQueue<std::string*> outputGAM { 50, params.numThreads, params.numThreads };
-	moodycamel::ConcurrentQueue<std::string*> outputGAF { 50, params.numThreads, params.numThreads };
-	moodycamel::ConcurrentQueue<std::string*> outputJSON { 50, params.numThreads, params.numThreads };
-	moodycamel::ConcurrentQueue<std::string*> deallocAlns;
-	moodycamel::ConcurrentQueue<std::string*> outputCorrected { 50, params.numThreads, params.numThreads };
-	moodycamel::ConcurrentQueue<std::string*> outputCorrectedClipped { 50, params.numThreads, params.numThreads };
-	moodycamel::ConcurrentQueue<std::shared_ptr<FastQ>> readFastqsQueue;
-	std::atomic<bool> readStreamingFinished { false };
-	std::atomic<bool> allThreadsDone { false };
-	std::atomic<bool> GAMWriteDone { false };
-	std::atomic<bool> GAFWriteDone { false };
-	std::atomic<bool> JSONWriteDone { false };
-	std::atomic<bool> correctedWriteDone { false };
-	std::atomic<bool> correctedClippedWriteDone { false };
+	//ordered output: enough reads can be buffered that each thread can work a batch ahead of the slowest one.
+	//the longest first scheduling can dispatch a read up to one scheduling window before an earlier read, which must fit too or the threads could wait on each others
+	size_t reorderWindowSize = params.orderedOutput ? ReadBatch::MaxReads * params.numThreads * 2 + params.schedulingWindow : 0;
+	//half of the queue memory for the reads waiting to be aligned, the other half split between the outputs waiting to be written.
+	//a single batch or output item bigger than its queue's share still gets through when the queue is empty
+	size_t queueMemoryBytes = params.queueMemory * 1024 * 1024;
+	size_t numOutputs = 0;
+	for (auto file : { params.outputGAMFile, params.outputGAFFile, params.outputBinaryFile, params.outputJSONFile, params.outputCorrectedFile, params.outputCorrectedClippedFile })
+	{
+		if (file != "") numOutputs += 1;
+	}
+	size_t outputQueueBytes = queueMemoryBytes / 2 / std::max(numOutputs, (size_t)1);
+	OutputQueue outputGAM { params.outputGAMFile != "", params.numThreads, outputQueueBytes, reorderWindowSize };
+	OutputQueue outputGAF { params.outputGAFFile != "", params.numThreads, outputQueueBytes, reorderWindowSize };
+	OutputQueue outputBinary { params.outputBinaryFile != "", params.numThreads, outputQueueBytes, reorderWindowSize };
+	OutputQueue outputJSON { params.outputJSONFile != "", params.numThreads, outputQueueBytes, reorderWindowSize };
+	OutputQueue outputCorrected { params.outputCorrectedFile != "", params.numThreads, outputQueueBytes, reorderWindowSize };
+	OutputQueue outputCorrectedClipped { params.outputCorrectedClippedFile != "", params.numThreads, outputQueueBytes, reorderWindowSize };
+	PipelineQueue<ReadBatch*> readFastqsQueue { params.numThreads * 2 + 2, queueMemoryBytes / 2, 1, [](ReadBatch* const& batch) { return batch->memoryBytes(); } };
+	moodycamel::ConcurrentQueue<ReadBatch*> recycledBatches;
+	AlignmentTaskPool* taskPool = nullptr;
+	if (params.parallelExtensionLength > 0) taskPool = new AlignmentTaskPool { params.numThreads };
 
 	std::cout << "Align" << std::endl;
 	AlignmentStats stats;
-	std::thread fastqThread { [files=params.fastqFiles, &readFastqsQueue, &readStreamingFinished]() { readFastqs(files, readFastqsQueue, readStreamingFinished); } };
-	std::thread GAMwriterThread { [file=params.outputGAMFile, &outputGAM, &deallocAlns, &allThreadsDone, &GAMWriteDone, verboseMode=params.verboseMode]() { if (file != "") consumeBytesAndWrite(file, outputGAM, deallocAlns, allThreadsDone, GAMWriteDone, verboseMode, false); else GAMWriteDone = true; } };
-	std::thread GAFwriterThread { [file=params.outputGAFFile, &outputGAF, &deallocAlns, &allThreadsDone, &GAFWriteDone, verboseMode=params.verboseMode]() { if (file != "") consumeBytesAndWrite(file, outputGAF, deallocAlns, allThreadsDone, GAFWriteDone, verboseMode, false); else GAFWriteDone = true; } };
-	std::thread JSONwriterThread { [file=params.outputJSONFile, &outputJSON, &deallocAlns, &allThreadsDone, &JSONWriteDone, verboseMode=params.verboseMode]() { if (file != "") consumeBytesAndWrite(file, outputJSON, deallocAlns, allThreadsDone, JSONWriteDone, verboseMode, true); else JSONWriteDone = true; } };
-	std::thread correctedWriterThread { [file=params.outputCorrectedFile, &outputCorrected, &deallocAlns, &allThreadsDone, &correctedWriteDone, verboseMode=params.verboseMode, uncompressed=!params.compressCorrected]() { if (file != "") consumeBytesAndWrite(file, outputCorrected, deallocAlns, allThreadsDone, correctedWriteDone, verboseMode, uncompressed); else correctedWriteDone = true; } };
-	std::thread correctedClippedWriterThread { [file=params.outputCorrectedClippedFile, &outputCorrectedClipped, &deallocAlns, &allThreadsDone, &correctedClippedWriteDone, verboseMode=params.verboseMode, uncompressed=!params.compressClipped]() { if (file != "") consumeBytesAndWrite(file, outputCorrectedClipped, deallocAlns, allThreadsDone, correctedClippedWriteDone, verboseMode, uncompressed); else correctedClippedWriteDone = true; } };
+	FileSeeder* streamedSeeds = params.seedFilesStreaming ? fileseeder : nullptr;
+	std::thread fastqThread { [files=params.fastqFiles, &readFastqsQueue, &recycledBatches, streamedSeeds, schedulingWindow=params.schedulingWindow]() { readFastqs(files, readFastqsQueue, recycledBatches, streamedSeeds, schedulingWindow); } };
+	std::thread GAMwriterThread { [file=params.outputGAMFile, &outputGAM, verboseMode=params.verboseMode]() { if (file != "") consumeBytesAndWrite(file, outputGAM, verboseMode, GAMFile); } };
+	std::thread GAFwriterThread { [file=params.outputGAFFile, &outputGAF, verboseMode=params.verboseMode, fileType=params.compressGAF ? BgzfFile : TextFile]() { if (file != "") consumeBytesAndWrite(file, outputGAF, verboseMode, fileType); } };
+	std::thread binaryWriterThread { [file=params.outputBinaryFile, &outputBinary, verboseMode=params.verboseMode]() { if (file != "") consumeBytesAndWrite(file, outputBinary, verboseMode, BinaryAlignmentFile); } };
+	std::thread JSONwriterThread { [file=params.outputJSONFile, &outputJSON, verboseMode=params.verboseMode]() { if (file != "") consumeBytesAndWrite(file, outputJSON, verboseMode, TextFile); } };
+	std::thread correctedWriterThread { [file=params.outputCorrectedFile, &outputCorrected, verboseMode=params.verboseMode, fileType=params.compressCorrected ? BgzfFile : TextFile]() { if (file != "") consumeBytesAndWrite(file, outputCorrected, verboseMode, fileType); } };
+	std::thread correctedClippedWriterThread { [file=params.outputCorrectedClippedFile, &outputCorrectedClipped, verboseMode=params.verboseMode, fileType=params.compressClipped ? BgzfFile : TextFile]() { if (file != "") consumeBytesAndWrite(file, outputCorrectedClipped, verboseMode, fileType); } };
 
 	for (size_t i = 0; i < params.numThreads; i++)
 	{
-		threads.emplace_back([&alignmentGraph, &readFastqsQueue, &readStreamingFinished, i, seeder, params, &outputGAM, &outputJSON, &outputGAF, &outputCorrected, &outputCorrectedClipped, &deallocAlns, &stats]() { runComponentMappings(alignmentGraph, readFastqsQueue, readStreamingFinished, i, seeder, params, outputGAM, outputJSON, outputGAF, outputCorrected, outputCorrectedClipped, deallocAlns, stats); });
+		threads.emplace_back([&alignmentGraph, &graphReplicas, &numaNodeCpus, &readFastqsQueue, &recycledBatches, i, seeder, params, &outputGAM, &outputJSON, &outputGAF, &outputBinary, &outputCorrected, &outputCorrectedClipped, taskPool, &stats]()
+		{
+			const AlignmentGraph* threadGraph = &alignmentGraph;
+			if (numaNodeCpus.size() > 0)
+			{
+				//pinned before the thread allocates its state so the state is on the local node
+				size_t node = i % numaNodeCpus.size();
+				Numa::PinThread(numaNodeCpus[node]);
+				if (graphReplicas.size() > 0) threadGraph = graphReplicas[node].get();
+			}
+			runComponentMappings(*threadGraph, readFastqsQueue, recycledBatches, i, seeder, params, outputGAM, outputJSON, outputGAF, outputBinary, outputCorrected, outputCorrectedClipped, taskPool, stats);
+		});
 	}
 
 	for (size_t i = 0; i < params.numThreads; i++)
@@ -702,10 +1518,16 @@ void alignReads(AlignerParams params)
 	}
 	assertSetRead("Postprocessing", "No seed");
 
-	allThreadsDone = true;
+	outputGAM.queue.close();
+	outputGAF.queue.close();
+	outputBinary.queue.close();
+	outputJSON.queue.close();
+	outputCorrected.queue.close();
+	outputCorrectedClipped.queue.close();
 
 	GAMwriterThread.join();
 	GAFwriterThread.join();
+	binaryWriterThread.join();
 	JSONwriterThread.join();
 	correctedWriterThread.join();
 	correctedClippedWriterThread.join();
@@ -713,11 +1535,13 @@ void alignReads(AlignerParams params)
 
 	if (mummerseeder != nullptr) delete mummerseeder;
 	if (minimizerseeder != nullptr) delete minimizerseeder;
+	if (fileseeder != nullptr) delete fileseeder;
+	if (taskPool != nullptr) delete taskPool;
 
-	std::string* dealloc;
-	while (deallocAlns.try_dequeue(dealloc))
+	ReadBatch* batch;
+	while (recycledBatches.try_dequeue(batch))
 	{
-		delete dealloc;
+		delete batch;
 	}
 
 	std::cout << "Alignment finished" << std::endl;
@@ -16,20 +16,29 @@ struct AlignerParams
 	int dynamicRowStart;
 	size_t maxCellsPerSlice;
 	std::vector<std::string> seedFiles;
+	bool seedFilesStreaming;
 	std::string outputGAMFile;
 	std::string outputJSONFile;
 	std::string outputGAFFile;
+	std::string outputBinaryFile;
 	std::string outputCorrectedFile;
 	std::string outputCorrectedClippedFile;
 	bool verboseMode;
 	bool tryAllSeeds;
 	bool highMemory;
+	size_t parallelExtensionLength;
 	size_t mxmLength;
+	size_t mxmSparseness;
 	size_t mumCount;
 	size_t memCount;
 	bool outputAllAlns;
+	bool orderedOutput;
+	size_t schedulingWindow;
+	size_t queueMemory;
+	std::string numaMode;
 	std::string seederCachePrefix;
 	bool forceGlobal;
+	bool compressGAF;
 	bool compressCorrected;
 	bool compressClipped;
 	bool preciseClipping;
@@ -37,6 +46,11 @@ struct AlignerParams
 	size_t minimizerLength;
 	size_t minimizerWindowSize;
 	size_t minimizerChunkSize;
+	bool minimizerSpanEdges;
+	size_t syncmerCount;
+	size_t syncmerLength;
+	size_t syncmerSmerLength;
+	size_t syncmerChunkSize;
 };
 
 void alignReads(AlignerParams params);
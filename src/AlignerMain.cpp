@@ -35,7 +35,7 @@ int main(int argc, char** argv)
 	mandatory.add_options()
 		("graph,g", boost::program_options::value<std::string>(), "input graph (.gfa / .vg)")
 		("reads,f", boost::program_options::value<std::vector<std::string>>()->multitoken(), "input reads (fasta or fastq, uncompressed or gzipped)")
-		("alignments-out,a", boost::program_options::value<std::vector<std::string>>(), "output alignment file (.gaf/.gam/.json)")
+		("alignments-out,a", boost::program_options::value<std::vector<std::string>>(), "output alignment file (.gaf/.gaf.gz/.gam/.json/.gab)")
 		("corrected-out", boost::program_options::value<std::string>(), "output corrected reads file (.fa/.fa.gz)")
 		("corrected-clipped-out", boost::program_options::value<std::string>(), "output corrected clipped reads file (.fa/.fa.gz)")
 	;
@@ -48,6 +48,9 @@ int main(int argc, char** argv)
 		("all-alignments", "return all alignments instead of the best non-overlapping alignments")
 		("try-all-seeds", "extend all seeds instead of a reasonable looking subset")
 		("global-alignment", "force the read to be aligned end-to-end even if the alignment score is poor")
+		("ordered-output", "write the output in the same order as the input reads")
+		("longest-first-window", boost::program_options::value<size_t>(), "read this many reads ahead and align the longest of them first (int) (default 0: input order)")
+		("queue-memory", boost::program_options::value<size_t>(), "memory limit in megabytes for the reads waiting to be aligned and the results waiting to be written (int) (default 1000)")
 	;
 	boost::program_options::options_description seeding("Seeding");
 	seeding.add_options()
@@ -55,11 +58,18 @@ int main(int argc, char** argv)
 		("seeds-minimizer-length", boost::program_options::value<size_t>(), "k-mer length for minimizer seeding (int)")
 		("seeds-minimizer-windowsize", boost::program_options::value<size_t>(), "window size for minimizer seeding (int)")
 		("seeds-minimizer-chunksize", boost::program_options::value<size_t>(), "chunk size for minimizer seeding (int)")
+		("seeds-minimizer-span-edges", "also index minimizers / syncmers which span edges between nodes. Recommended for graphs with short nodes")
+		("seeds-syncmer-count", boost::program_options::value<size_t>(), "arg least common closed syncmers per chunk (int) (-1 for all)")
+		("seeds-syncmer-length", boost::program_options::value<size_t>(), "k-mer length for closed syncmer seeding (int)")
+		("seeds-syncmer-smerlength", boost::program_options::value<size_t>(), "s-mer length for closed syncmer seeding (int)")
+		("seeds-syncmer-chunksize", boost::program_options::value<size_t>(), "chunk size for closed syncmer seeding (int)")
 		("seeds-mum-count", boost::program_options::value<size_t>(), "arg longest maximal unique matches fully contained in a node (int) (-1 for all)")
 		("seeds-mem-count", boost::program_options::value<size_t>(), "arg longest maximal exact matches fully contained in a node (int) (-1 for all)")
 		("seeds-mxm-length", boost::program_options::value<size_t>(), "minimum length for maximal unique / exact matches (int)")
+		("seeds-mxm-sparseness", boost::program_options::value<size_t>(), "index only every n'th suffix for mum/mem seeds, uses less memory but misses matches shorter than n (int)")
 		("seeds-mxm-cache-prefix", boost::program_options::value<std::string>(), "store the mum/mem seeding index to the disk for reuse, or reuse it if it exists (filename prefix)")
-		("seeds-file,s", boost::program_options::value<std::vector<std::string>>()->multitoken(), "external seeds (.gam)")
+		("seeds-file,s", boost::program_options::value<std::vector<std::string>>()->multitoken(), "external seeds (.gam or binary seed file from ConvertSeeds)")
+		("seeds-file-streaming", "seed files are grouped by read name in the same order as the reads, stream them alongside the reads instead of loading them all into memory")
 		("seeds-first-full-rows", boost::program_options::value<int>(), "no seeding, instead calculate the first arg rows fully. VERY SLOW except on tiny graphs (int)")
 	;
 	boost::program_options::options_description alignment("Extension");
@@ -68,6 +78,8 @@ int main(int argc, char** argv)
 		("ramp-bandwidth,B", boost::program_options::value<size_t>(), "ramp bandwidth (int)")
 		("tangle-effort,C", boost::program_options::value<size_t>(), "tangle effort limit, higher results in slower but more accurate alignments (int) (-1 for unlimited)")
 		("high-memory", "use slightly less CPU but a lot more memory")
+		("numa", boost::program_options::value<std::string>(), "placement on multi-socket machines: off, interleave (pin threads to NUMA nodes, spread the graph and index over the nodes) or replicate (also copy the graph to each node) (default off)")
+		("parallel-extension-length", boost::program_options::value<size_t>(), "extend the seeds of reads at least this long with several threads (int) (default 0: never)")
 	;
 	boost::program_options::options_description hidden("hidden");
 	hidden.add_options()
@@ -93,7 +105,8 @@ int main(int argc, char** argv)
 	if (vm.count("help"))
 	{
 		std::cerr << mandatory << std::endl << general << std::endl << seeding;
-		std::cerr << "defaults are --seeds-minimizer-count 5 --seeds-minimizer-length 19 --seeds-minimizer-windowsize 30 --seeds-minimizer-chunksize 100" << std::endl << std::endl;
+		std::cerr << "defaults are --seeds-minimizer-count 5 --seeds-minimizer-length 19 --seeds-minimizer-windowsize 30 --seeds-minimizer-chunksize 100" << std::endl;
+		std::cerr << "syncmer defaults are --seeds-syncmer-length 19 --seeds-syncmer-smerlength 5 --seeds-syncmer-chunksize 100" << std::endl << std::endl;
 		std::cerr << alignment;
 		std::cerr << "defaults are -b 5 -B 10 -C 10000" << std::endl << std::endl;
 		std::exit(0);
@@ -109,6 +122,7 @@ int main(int argc, char** argv)
 	params.outputGAMFile = "";
 	params.outputJSONFile = "";
 	params.outputGAFFile = "";
+	params.outputBinaryFile = "";
 	params.outputCorrectedFile = "";
 	params.outputCorrectedClippedFile = "";
 	params.numThreads = 1;
@@ -119,12 +133,20 @@ int main(int argc, char** argv)
 	params.verboseMode = false;
 	params.tryAllSeeds = false;
 	params.highMemory = false;
+	params.parallelExtensionLength = 0;
+	params.numaMode = "off";
+	params.seedFilesStreaming = false;
 	params.mxmLength = 20;
+	params.mxmSparseness = 1;
 	params.mumCount = 0;
 	params.memCount = 0;
 	params.seederCachePrefix = "";
 	params.outputAllAlns = false;
+	params.orderedOutput = false;
+	params.schedulingWindow = 0;
+	params.queueMemory = 1000;
 	params.forceGlobal = false;
+	params.compressGAF = false;
 	params.compressCorrected = false;
 	params.compressClipped = false;
 	params.preciseClipping = false;
@@ -132,6 +154,11 @@ int main(int argc, char** argv)
 	params.minimizerLength = 19;
 	params.minimizerWindowSize = 30;
 	params.minimizerChunkSize = 100;
+	params.minimizerSpanEdges = false;
+	params.syncmerCount = 0;
+	params.syncmerLength = 19;
+	params.syncmerSmerLength = 5;
+	params.syncmerChunkSize = 100;
 
 	std::vector<std::string> outputAlns;
 
@@ -147,8 +174,15 @@ int main(int argc, char** argv)
 	if (vm.count("seeds-minimizer-length")) params.minimizerLength = vm["seeds-minimizer-length"].as<size_t>();
 	if (vm.count("seeds-minimizer-windowsize")) params.minimizerWindowSize = vm["seeds-minimizer-windowsize"].as<size_t>();
 	if (vm.count("seeds-minimizer-chunksize")) params.minimizerChunkSize = vm["seeds-minimizer-chunksize"].as<size_t>();
+	if (vm.count("seeds-minimizer-span-edges")) params.minimizerSpanEdges = true;
+	if (vm.count("seeds-syncmer-count")) params.syncmerCount = vm["seeds-syncmer-count"].as<size_t>();
+	if (vm.count("seeds-syncmer-length")) params.syncmerLength = vm["seeds-syncmer-length"].as<size_t>();
+	if (vm.count("seeds-syncmer-smerlength")) params.syncmerSmerLength = vm["seeds-syncmer-smerlength"].as<size_t>();
+	if (vm.count("seeds-syncmer-chunksize")) params.syncmerChunkSize = vm["seeds-syncmer-chunksize"].as<size_t>();
 	if (vm.count("seeds-file")) params.seedFiles = vm["seeds-file"].as<std::vector<std::string>>();
+	if (vm.count("seeds-file-streaming")) params.seedFilesStreaming = true;
 	if (vm.count("seeds-mxm-length")) params.mxmLength = vm["seeds-mxm-length"].as<size_t>();
+	if (vm.count("seeds-mxm-sparseness")) params.mxmSparseness = vm["seeds-mxm-sparseness"].as<size_t>();
 	if (vm.count("seeds-mem-count")) params.memCount = vm["seeds-mem-count"].as<size_t>();
 	if (vm.count("seeds-mum-count")) params.mumCount = vm["seeds-mum-count"].as<size_t>();
 	if (vm.count("seeds-mxm-cache-prefix")) params.seederCachePrefix = vm["seeds-mxm-cache-prefix"].as<std::string>();
@@ -164,7 +198,12 @@ int main(int argc, char** argv)
 	if (vm.count("verbose")) params.verboseMode = true;
 	if (vm.count("try-all-seeds")) params.tryAllSeeds = true;
 	if (vm.count("high-memory")) params.highMemory = true;
+	if (vm.count("numa")) params.numaMode = vm["numa"].as<std::string>();
+	if (vm.count("parallel-extension-length")) params.parallelExtensionLength = vm["parallel-extension-length"].as<size_t>();
 	if (vm.count("global-alignment")) params.forceGlobal = true;
+	if (vm.count("ordered-output")) params.orderedOutput = true;
+	if (vm.count("longest-first-window")) params.schedulingWindow = vm["longest-first-window"].as<size_t>();
+	if (vm.count("queue-memory")) params.queueMemory = vm["queue-memory"].as<size_t>();
 	if (vm.count("precise-clipping")) params.preciseClipping = true;
 
 	bool paramError = false;
@@ -198,9 +237,18 @@ int main(int argc, char** argv)
 		{
 			params.outputGAFFile = file;
 		}
+		else if (file.size() >= 7 && file.substr(file.size()-7) == ".gaf.gz")
+		{
+			params.outputGAFFile = file;
+			params.compressGAF = true;
+		}
+		else if (file.substr(file.size()-4) == ".gab")
+		{
+			params.outputBinaryFile = file;
+		}
 		else
 		{
-			std::cerr << "unknown output alignment format (" << file << "), must be either .gaf, .gam or .json" << std::endl;
+			std::cerr << "unknown output alignment format (" << file << "), must be either .gaf, .gaf.gz, .gam, .json or .gab" << std::endl;
 			paramError = true;
 		}
 	}
@@ -219,6 +267,11 @@ int main(int argc, char** argv)
 		std::cerr << "first-full-rows has to be a multiple of 64" << std::endl;
 		paramError = true;
 	}
+	if (params.numaMode != "off" && params.numaMode != "interleave" && params.numaMode != "replicate")
+	{
+		std::cerr << "numa must be off, interleave or replicate" << std::endl;
+		paramError = true;
+	}
 	if (params.numThreads < 1)
 	{
 		std::cerr << "number of threads must be >= 1" << std::endl;
@@ -246,12 +299,32 @@ int main(int argc, char** argv)
 		std::cerr << "mum/mem minimum length must be >= 2" << std::endl;
 		paramError = true;
 	}
+	if (params.mxmSparseness < 1)
+	{
+		std::cerr << "mum/mem sparseness must be >= 1" << std::endl;
+		paramError = true;
+	}
+	if (params.mxmLength < params.mxmSparseness)
+	{
+		std::cerr << "mum/mem minimum length must be at least the sparseness" << std::endl;
+		paramError = true;
+	}
 	if (params.minimizerLength >= sizeof(size_t)*8/2)
 	{
 		std::cerr << "Maximum minimizer length is " << (sizeof(size_t)*8/2)-1 << std::endl;
 		paramError = true;
 	}
-	int pickedSeedingMethods = ((params.dynamicRowStart != 0) ? 1 : 0) + ((params.seedFiles.size() > 0) ? 1 : 0) + ((params.mumCount != 0) ? 1 : 0) + ((params.memCount != 0) ? 1 : 0) + ((params.minimizerCount != 0) ? 1 : 0);
+	if (params.syncmerLength >= sizeof(size_t)*8/2)
+	{
+		std::cerr << "Maximum syncmer length is " << (sizeof(size_t)*8/2)-1 << std::endl;
+		paramError = true;
+	}
+	if (params.syncmerSmerLength < 1 || params.syncmerSmerLength >= params.syncmerLength)
+	{
+		std::cerr << "syncmer s-mer length must be >= 1 and shorter than the syncmer length" << std::endl;
+		paramError = true;
+	}
+	int pickedSeedingMethods = ((params.dynamicRowStart != 0) ? 1 : 0) + ((params.seedFiles.size() > 0) ? 1 : 0) + ((params.mumCount != 0) ? 1 : 0) + ((params.memCount != 0) ? 1 : 0) + ((params.minimizerCount != 0) ? 1 : 0) + ((params.syncmerCount != 0) ? 1 : 0);
 	if (pickedSeedingMethods == 0)
 	{
 		//use minimizers as the default seeding method
@@ -5,6 +5,7 @@
 #include "CommonUtils.h"
 #include "GfaGraph.h"
 #include "fastqloader.h"
+#include "BinaryAlignment.h"
 
 bool fakeLengths = false;
 
@@ -37,6 +38,7 @@ struct Alignment
 	std::string name;
 };
 
+//the length of a node is the read bases aligned to it, the same in GAM and binary alignment files
 Alignment convertVGtoAlignment(const vg::Alignment& vgAln)
 {
 	Alignment result;
@@ -46,7 +48,44 @@ Alignment convertVGtoAlignment(const vg::Alignment& vgAln)
 		result.path.emplace_back();
 		result.path.back().nodeId = vgAln.path().mapping(i).position().node_id();
 		result.path.back().reverse = vgAln.path().mapping(i).position().is_reverse();
-		result.length.emplace_back(vgAln.path().mapping(i).edit(0).to_length());
+		size_t readLength = 0;
+		for (int j = 0; j < vgAln.path().mapping(i).edit_size(); j++)
+		{
+			readLength += vgAln.path().mapping(i).edit(j).to_length();
+		}
+		result.length.emplace_back(readLength);
+	}
+	return result;
+}
+
+Alignment convertRecordToAlignment(const BinaryAlignment::Record& record)
+{
+	Alignment result;
+	result.name = record.name;
+	for (const auto& step : record.path)
+	{
+		result.path.emplace_back();
+		result.path.back().nodeId = step.nodeId;
+		result.path.back().reverse = step.reverse;
+		result.length.emplace_back(step.readLength);
+	}
+	return result;
+}
+
+std::vector<Alignment> loadAlignments(const std::string& filename)
+{
+	std::vector<Alignment> result;
+	if (BinaryAlignment::IsBinaryAlignmentFile(filename))
+	{
+		BinaryAlignment::ForEachRecord(filename, [&result](const BinaryAlignment::Record& record) {
+			result.push_back(convertRecordToAlignment(record));
+		});
+		return result;
+	}
+	auto vgalns = CommonUtils::LoadVGAlignments(filename);
+	for (auto vg : vgalns)
+	{
+		result.push_back(convertVGtoAlignment(vg));
 	}
 	return result;
 }
@@ -124,22 +163,8 @@ int main(int argc, char** argv)
 		}
 	}
 
-	std::vector<Alignment> transcripts;
-	std::vector<Alignment> reads;
-	{
-		auto vgtranscripts = CommonUtils::LoadVGAlignments(transcriptFile);
-		for (auto vg : vgtranscripts)
-		{
-			transcripts.push_back(convertVGtoAlignment(vg));
-		}
-	}
-	{
-		auto vgreads = CommonUtils::LoadVGAlignments(readAlignmentFile);
-		for (auto vg : vgreads)
-		{
-			reads.push_back(convertVGtoAlignment(vg));
-		}
-	}
+	std::vector<Alignment> transcripts = loadAlignments(transcriptFile);
+	std::vector<Alignment> reads = loadAlignments(readAlignmentFile);
 
 	std::unordered_map<int, std::vector<size_t>> transcriptsCrossingNode;
 	for (size_t i = 0; i < transcripts.size(); i++)
@@ -0,0 +1,92 @@
+#include <cassert>
+#include <algorithm>
+#include "AlignmentTaskPool.h"
+
+AlignmentTaskPool::AlignmentTaskPool(size_t numWorkers) :
+workers(numWorkers),
+runningWorkers(numWorkers),
+queue(),
+mutex(),
+changed()
+{
+}
+
+size_t AlignmentTaskPool::numWorkers() const
+{
+	return workers;
+}
+
+void AlignmentTaskPool::runTask(std::unique_lock<std::mutex>& lock, QueuedTask task, State& state)
+{
+	lock.unlock();
+	std::exception_ptr error;
+	try
+	{
+		(*task.task)(state);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+		//the state might be left in the middle of an alignment
+		state.clear();
+	}
+	lock.lock();
+	if (error && !task.group->error) task.group->error = error;
+	assert(task.group->unfinished > 0);
+	task.group->unfinished -= 1;
+	if (task.group->unfinished == 0) changed.notify_all();
+}
+
+void AlignmentTaskPool::runTasks(const std::vector<Task>& tasks, State& ownState)
+{
+	if (tasks.size() == 0) return;
+	TaskGroup group;
+	group.unfinished = tasks.size();
+	std::unique_lock<std::mutex> lock { mutex };
+	for (const auto& task : tasks)
+	{
+		queue.push_back(QueuedTask { &task, &group });
+	}
+	changed.notify_all();
+	while (group.unfinished > 0)
+	{
+		//prefer our own tasks so the read finishes as soon as possible
+		auto own = std::find_if(queue.begin(), queue.end(), [&group](const QueuedTask& task) { return task.group == &group; });
+		if (own != queue.end())
+		{
+			QueuedTask task = *own;
+			queue.erase(own);
+			runTask(lock, task, ownState);
+			continue;
+		}
+		//the rest are being run by other threads
+		changed.wait(lock, [&group]() { return group.unfinished == 0; });
+	}
+	if (group.error) std::rethrow_exception(group.error);
+}
+
+bool AlignmentTaskPool::tryHelp(State& state)
+{
+	std::unique_lock<std::mutex> lock { mutex };
+	if (queue.size() == 0) return false;
+	QueuedTask task = queue.front();
+	queue.pop_front();
+	runTask(lock, task, state);
+	return true;
+}
+
+void AlignmentTaskPool::helpUntilAllFinished(State& state)
+{
+	std::unique_lock<std::mutex> lock { mutex };
+	assert(runningWorkers > 0);
+	runningWorkers -= 1;
+	changed.notify_all();
+	while (true)
+	{
+		changed.wait(lock, [this]() { return queue.size() > 0 || runningWorkers == 0; });
+		if (queue.size() == 0) break;
+		QueuedTask task = queue.front();
+		queue.pop_front();
+		runTask(lock, task, state);
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef AlignmentTaskPool_h
+#define AlignmentTaskPool_h
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include "vg.pb.h"
+#include "GraphAlignerCommon.h"
+
+//lets the aligner threads share the seed extensions of very long reads.
+//a thread with a long read splits it into tasks, and threads between reads or out of reads steal them.
+//each task runs with the reusable state of the thread which runs it
+class AlignmentTaskPool
+{
+public:
+	using State = GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState;
+	using Task = std::function<void(State&)>;
+	AlignmentTaskPool(size_t numWorkers);
+	AlignmentTaskPool(const AlignmentTaskPool& other) = delete;
+	AlignmentTaskPool& operator=(const AlignmentTaskPool& other) = delete;
+	size_t numWorkers() const;
+	//runs the tasks with the calling thread and any helping threads and returns once all of them are done.
+	//an exception thrown by a task is rethrown here
+	void runTasks(const std::vector<Task>& tasks, State& ownState);
+	//runs one task of another thread if there is one, never blocks
+	bool tryHelp(State& state);
+	//called by a worker thread which is out of reads. helps the other threads until they are out of reads too
+	void helpUntilAllFinished(State& state);
+private:
+	struct TaskGroup
+	{
+		size_t unfinished;
+		std::exception_ptr error;
+	};
+	struct QueuedTask
+	{
+		const Task* task;
+		TaskGroup* group;
+	};
+	//called with the lock held, lock is released while the task runs
+	void runTask(std::unique_lock<std::mutex>& lock, QueuedTask task, State& state);
+	size_t workers;
+	size_t runningWorkers;
+	std::deque<QueuedTask> queue;
+	std::mutex mutex;
+	std::condition_variable changed;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include <cassert>
+#include <stdexcept>
+#include <cstdint>
+#include <algorithm>
+#include <zlib.h>
+#include "BgzfCompression.h"
+
+namespace
+{
+	//same limits as htslib. the input of a block is small enough that it fits in a block even if it doesn't compress at all
+	const size_t MaxBlockSize = 65536;
+	const size_t MaxBlockInput = 0xff00;
+	const size_t HeaderSize = 18;
+	const size_t FooterSize = 8;
+
+	void putLittleEndian(std::string& out, size_t pos, uint32_t value, size_t bytes)
+	{
+		for (size_t i = 0; i < bytes; i++)
+		{
+			out[pos+i] = (char)((value >> (8 * i)) & 0xff);
+		}
+	}
+
+	void compressBlock(const char* data, size_t size, std::string& out)
+	{
+		assert(size <= MaxBlockInput);
+		size_t blockStart = out.size();
+		out.resize(blockStart + MaxBlockSize);
+		//gzip header with the BC extra field, which holds the size of the whole block
+		const unsigned char header[HeaderSize] { 0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 0x06, 0, 'B', 'C', 0x02, 0, 0, 0 };
+		for (size_t i = 0; i < HeaderSize; i++) out[blockStart+i] = (char)header[i];
+		z_stream stream {};
+		if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) throw std::runtime_error { "Could not initialize compression" };
+		stream.next_in = (Bytef*)data;
+		stream.avail_in = size;
+		stream.next_out = (Bytef*)&out[blockStart + HeaderSize];
+		stream.avail_out = MaxBlockSize - HeaderSize - FooterSize;
+		int result = deflate(&stream, Z_FINISH);
+		size_t compressedSize = stream.total_out;
+		deflateEnd(&stream);
+		if (result != Z_STREAM_END) throw std::runtime_error { "Could not compress block" };
+		size_t blockSize = HeaderSize + compressedSize + FooterSize;
+		assert(blockSize <= MaxBlockSize);
+		putLittleEndian(out, blockStart + 16, blockSize - 1, 2);
+		uint32_t crc = crc32(crc32(0, Z_NULL, 0), (const Bytef*)data, size);
+		putLittleEndian(out, blockStart + HeaderSize + compressedSize, crc, 4);
+		putLittleEndian(out, blockStart + HeaderSize + compressedSize + 4, size, 4);
+		out.resize(blockStart + blockSize);
+	}
+}
+
+namespace Bgzf
+{
+	void CompressBlocks(const std::string& data, std::string& out)
+	{
+		for (size_t start = 0; start < data.size(); start += MaxBlockInput)
+		{
+			compressBlock(data.data() + start, std::min(MaxBlockInput, data.size() - start), out);
+		}
+	}
+
+	const std::string& EofBlock()
+	{
+		static const std::string eof { "\x1f\x8b\x08\x04\x00\x00\x00\x00\x00\xff\x06\x00\x42\x43\x02\x00\x1b\x00\x03\x00\x00\x00\x00\x00\x00\x00\x00\x00", 28 };
+		return eof;
+	}
+}
@@ -0,0 +1,16 @@
+#ifndef BgzfCompression_h
+#define BgzfCompression_h
+
+#include <string>
+
+//BGZF (the blocked gzip of bgzip and htslib) compression. every block is an independent gzip member of at most 64kb,
+//so the blocks can be compressed in parallel, concatenated in any grouping and indexed for random access
+namespace Bgzf
+{
+	//compresses the data into full size blocks and appends them to out
+	void CompressBlocks(const std::string& data, std::string& out);
+	//the empty block which marks the end of a BGZF file
+	const std::string& EofBlock();
+}
+
+#endif
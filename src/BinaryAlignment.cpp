@@ -0,0 +1,216 @@
+#include <cassert>
+#include <stdexcept>
+#include "BinaryAlignment.h"
+#include "stream.hpp"
+
+namespace
+{
+	const char Magic[] { 'G', 'A', 'B', '\x01' };
+	//no real record comes close, so a bigger length prefix means the file is corrupted
+	const uint64_t MaxRecordSize = 1024 * 1024 * 1024;
+	//each step has four varints of at least one byte
+	const size_t MinStepSize = 4;
+
+	void appendVarint(std::string& out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out += (char)((value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+		out += (char)value;
+	}
+
+	uint64_t zigzag(int64_t value)
+	{
+		return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	}
+
+	int64_t unzigzag(uint64_t value)
+	{
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+
+	uint64_t parseVarint(const std::string& buffer, size_t& pos)
+	{
+		uint64_t result = 0;
+		for (size_t shift = 0; shift < 64; shift += 7)
+		{
+			if (pos == buffer.size()) throw std::runtime_error { "Truncated record in binary alignment file" };
+			unsigned char c = buffer[pos];
+			pos++;
+			result |= (uint64_t)(c & 0x7f) << shift;
+			if ((c & 0x80) == 0) return result;
+		}
+		throw std::runtime_error { "Invalid varint in binary alignment file" };
+	}
+}
+
+namespace BinaryAlignment
+{
+	const std::string& FileHeader()
+	{
+		static const std::string header { Magic, sizeof(Magic) };
+		return header;
+	}
+
+	void AppendRecord(std::string& out, const Record& record)
+	{
+		//reused so a record doesn't allocate once the buffer is big enough
+		thread_local std::string body;
+		body.clear();
+		appendVarint(body, record.name.size());
+		body += record.name;
+		assert(record.queryEnd >= record.queryStart);
+		appendVarint(body, record.queryStart);
+		appendVarint(body, record.queryEnd - record.queryStart);
+		appendVarint(body, zigzag(record.score));
+		appendVarint(body, record.path.size());
+		int64_t previousNode = 0;
+		for (const auto& step : record.path)
+		{
+			//the orientation goes into the lowest bit of the node delta
+			appendVarint(body, (zigzag(step.nodeId - previousNode) << 1) + (step.reverse ? 1 : 0));
+			appendVarint(body, step.offset);
+			appendVarint(body, step.graphLength);
+			appendVarint(body, step.readLength);
+			previousNode = step.nodeId;
+		}
+		appendVarint(out, body.size());
+		out += body;
+	}
+
+	Record FromVG(const vg::Alignment& alignment)
+	{
+		Record result;
+		result.name = alignment.name();
+		result.queryStart = alignment.query_position();
+		result.queryEnd = alignment.query_position() + alignment.sequence().size();
+		result.score = alignment.score();
+		for (int i = 0; i < alignment.path().mapping_size(); i++)
+		{
+			const auto& mapping = alignment.path().mapping(i);
+			Step step;
+			step.nodeId = mapping.position().node_id();
+			step.reverse = mapping.position().is_reverse();
+			step.offset = mapping.position().offset();
+			step.graphLength = 0;
+			step.readLength = 0;
+			for (int j = 0; j < mapping.edit_size(); j++)
+			{
+				step.graphLength += mapping.edit(j).from_length();
+				step.readLength += mapping.edit(j).to_length();
+			}
+			result.path.push_back(step);
+		}
+		return result;
+	}
+
+	bool IsBinaryAlignmentFile(const std::string& filename)
+	{
+		std::ifstream file { filename, std::ios::in | std::ios::binary };
+		char header[sizeof(Magic)];
+		if (!file.read(header, sizeof(header))) return false;
+		return std::string { header, sizeof(header) } == FileHeader();
+	}
+
+	Reader::Reader(const std::string& filename) :
+	file(filename, std::ios::in | std::ios::binary),
+	buffer()
+	{
+		if (!file.good()) throw std::runtime_error { "Could not open " + filename };
+		char header[sizeof(Magic)];
+		if (!file.read(header, sizeof(header)) || std::string { header, sizeof(header) } != FileHeader()) throw std::runtime_error { filename + " is not a binary alignment file" };
+	}
+
+	bool Reader::readVarint(uint64_t& value)
+	{
+		value = 0;
+		for (size_t shift = 0; shift < 64; shift += 7)
+		{
+			int c = file.get();
+			if (c == std::char_traits<char>::eof())
+			{
+				if (shift == 0) return false;
+				throw std::runtime_error { "Truncated binary alignment file" };
+			}
+			value |= (uint64_t)(c & 0x7f) << shift;
+			if ((c & 0x80) == 0) return true;
+		}
+		throw std::runtime_error { "Invalid varint in binary alignment file" };
+	}
+
+	bool Reader::next(Record& record)
+	{
+		uint64_t size;
+		if (!readVarint(size)) return false;
+		if (size > MaxRecordSize) throw std::runtime_error { "Invalid record length in binary alignment file" };
+		buffer.resize(size);
+		if (!file.read(&buffer[0], size)) throw std::runtime_error { "Truncated binary alignment file" };
+		size_t pos = 0;
+		size_t nameLength = parseVarint(buffer, pos);
+		if (nameLength > buffer.size() - pos) throw std::runtime_error { "Truncated record in binary alignment file" };
+		record.name.assign(buffer, pos, nameLength);
+		pos += nameLength;
+		record.queryStart = parseVarint(buffer, pos);
+		record.queryEnd = record.queryStart + parseVarint(buffer, pos);
+		record.score = unzigzag(parseVarint(buffer, pos));
+		size_t steps = parseVarint(buffer, pos);
+		if (steps > (buffer.size() - pos) / MinStepSize) throw std::runtime_error { "Truncated record in binary alignment file" };
+		record.path.resize(steps);
+		int64_t previousNode = 0;
+		for (size_t i = 0; i < steps; i++)
+		{
+			uint64_t node = parseVarint(buffer, pos);
+			record.path[i].reverse = (node & 1) == 1;
+			record.path[i].nodeId = previousNode + unzigzag(node >> 1);
+			record.path[i].offset = parseVarint(buffer, pos);
+			record.path[i].graphLength = parseVarint(buffer, pos);
+			record.path[i].readLength = parseVarint(buffer, pos);
+			previousNode = record.path[i].nodeId;
+		}
+		return true;
+	}
+
+	void ForEachRecord(const std::string& filename, std::function<void(const Record&)> f)
+	{
+		if (IsBinaryAlignmentFile(filename))
+		{
+			Reader reader { filename };
+			Record record;
+			while (reader.next(record)) f(record);
+			return;
+		}
+		std::ifstream file { filename, std::ios::in | std::ios::binary };
+		std::function<void(vg::Alignment&)> lambda = [&f](vg::Alignment& aln) {
+			f(FromVG(aln));
+		};
+		stream::for_each(file, lambda);
+	}
+
+	std::vector<Record> LoadRecords(const std::string& filename)
+	{
+		std::vector<Record> result;
+		ForEachRecord(filename, [&result](const Record& record) { result.push_back(record); });
+		return result;
+	}
+
+	void WriteRecords(const std::string& filename, const std::vector<Record>& records)
+	{
+		std::ofstream file { filename, std::ios::out | std::ios::binary };
+		if (!file.good()) throw std::runtime_error { "Could not open " + filename };
+		std::string buffer = FileHeader();
+		for (const auto& record : records)
+		{
+			AppendRecord(buffer, record);
+			if (buffer.size() >= 1024 * 1024)
+			{
+				file.write(buffer.data(), buffer.size());
+				buffer.clear();
+			}
+		}
+		file.write(buffer.data(), buffer.size());
+		file.close();
+		if (file.fail()) throw std::runtime_error { "Could not write to " + filename };
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef BinaryAlignment_h
+#define BinaryAlignment_h
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include "vg.pb.h"
+
+//compact binary alignment file (.gab) for passing alignments between pipeline stages without protobuf and gzip.
+//the file starts with a magic header, followed by records each prefixed with their byte length as a varint.
+//a record holds the read name, the aligned read interval, the score and the path as one step per node,
+//with the node ids delta coded and the lengths as varints.
+//node ids are the ids of the input graph with the orientation in a separate flag, the same as in GAM files.
+//the aligner's digraph has a node per orientation with the id (id * 2 + reverse), which AppendBinaryRecord
+//converts when writing a record, so a GAM file and a .gab file of the same alignments give the same records
+namespace BinaryAlignment
+{
+	struct Step
+	{
+		//node id in the input graph, not the aligner's digraph
+		int64_t nodeId;
+		bool reverse;
+		//where the alignment enters the node
+		size_t offset;
+		//graph bases and read bases aligned in the node
+		size_t graphLength;
+		size_t readLength;
+	};
+	struct Record
+	{
+		std::string name;
+		//read interval [queryStart, queryEnd)
+		size_t queryStart;
+		size_t queryEnd;
+		int64_t score;
+		std::vector<Step> path;
+	};
+	const std::string& FileHeader();
+	//appends the record with its length prefix
+	void AppendRecord(std::string& out, const Record& record);
+	//the read interval, score and per node lengths of a vg alignment. the node ids are copied as they are,
+	//so the alignment must have input graph ids like the GAM files written by GraphAligner
+	Record FromVG(const vg::Alignment& alignment);
+	//checks the magic header
+	bool IsBinaryAlignmentFile(const std::string& filename);
+	class Reader
+	{
+	public:
+		Reader(const std::string& filename);
+		//returns false at the end of the file. the record's buffers are reused
+		bool next(Record& record);
+	private:
+		bool readVarint(uint64_t& value);
+		std::ifstream file;
+		std::string buffer;
+	};
+	//reads a binary alignment file, or a GAM file converted record by record
+	void ForEachRecord(const std::string& filename, std::function<void(const Record&)> f);
+	std::vector<Record> LoadRecords(const std::string& filename);
+	//writes the header and the records. throws if the file can't be written
+	void WriteRecords(const std::string& filename, const std::vector<Record>& records);
+}
+
+#endif
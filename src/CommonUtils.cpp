@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <cstdlib>
 #include "CommonUtils.h"
 #include "stream.hpp"
 
@@ -13,27 +15,11 @@ namespace CommonUtils
 		//eg alignments 12000bp and 15000bp, overlap of 12000*0.05 = 600bp means they are incompatible
 		const float OverlapIncompatibleFractionCutoff = 0.05;
 
-		//longer alignments are better
-		bool alignmentLengthCompare(const vg::Alignment* const left, const vg::Alignment* const right)
+		bool alignmentIncompatible(size_t leftStart, size_t leftEnd, size_t rightStart, size_t rightEnd)
 		{
-			return left->sequence().size() > right->sequence().size();
-		}
-
-		//lower scores are better
-		bool alignmentScoreCompare(const vg::Alignment* const left, const vg::Alignment* const right)
-		{
-			return left->score() < right->score();
-		}
-
-		bool alignmentIncompatible(const vg::Alignment* const left, const vg::Alignment* const right)
-		{
-			auto minOverlapLen = std::min(left->sequence().size(), right->sequence().size()) * OverlapIncompatibleFractionCutoff;
-			assert(left->query_position() >= 0);
-			assert(right->query_position() >= 0);
-			size_t leftStart = left->query_position();
-			size_t leftEnd = leftStart + left->sequence().size();
-			size_t rightStart = right->query_position();
-			size_t rightEnd = rightStart + right->sequence().size();
+			assert(leftEnd >= leftStart);
+			assert(rightEnd >= rightStart);
+			auto minOverlapLen = std::min(leftEnd - leftStart, rightEnd - rightStart) * OverlapIncompatibleFractionCutoff;
 			if (leftStart > rightStart)
 			{
 				std::swap(leftStart, rightStart);
@@ -56,6 +42,246 @@ namespace CommonUtils
 		return SelectAlignments(alns, maxnum, [](vg::Alignment* aln) { return aln; });
 	}
 
+	void AppendNumber(std::string& out, size_t value)
+	{
+		char digits[20];
+		size_t pos = sizeof(digits);
+		do
+		{
+			pos--;
+			digits[pos] = '0' + (value % 10);
+			value /= 10;
+		} while (value > 0);
+		out.append(digits + pos, sizeof(digits) - pos);
+	}
+
+	void appendSignedNumber(std::string& out, int64_t value)
+	{
+		if (value < 0)
+		{
+			out += '-';
+			AppendNumber(out, -(uint64_t)value);
+			return;
+		}
+		AppendNumber(out, value);
+	}
+
+	//escapes the same way as protobuf's json printer. returns false for non-ASCII strings, which are left to protobuf
+	bool appendJSONString(std::string& out, const std::string& str)
+	{
+		static const char hexDigits[] = "0123456789abcdef";
+		out += '"';
+		for (unsigned char c : str)
+		{
+			switch(c)
+			{
+				case '"': out += "\\\""; break;
+				case '\\': out += "\\\\"; break;
+				case '\b': out += "\\b"; break;
+				case '\t': out += "\\t"; break;
+				case '\n': out += "\\n"; break;
+				case '\f': out += "\\f"; break;
+				case '\r': out += "\\r"; break;
+				default:
+					if (c >= 0x80) return false;
+					if (c < 0x20 || c == '<' || c == '>' || c == 0x7f)
+					{
+						out += "\\u00";
+						out += hexDigits[c >> 4];
+						out += hexDigits[c & 0xf];
+					}
+					else
+					{
+						out += c;
+					}
+					break;
+			}
+		}
+		out += '"';
+		return true;
+	}
+
+	//shortest of 15 or 17 significant digits which reads back as the same value, like protobuf
+	void appendJSONDouble(std::string& out, double value)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%.15g", value);
+		if (strtod(buffer, nullptr) != value) snprintf(buffer, sizeof(buffer), "%.17g", value);
+		out += buffer;
+	}
+
+	//writes the "key": part, with a comma if the object already has fields
+	void appendJSONKey(std::string& out, bool& firstField, const char* key)
+	{
+		if (!firstField) out += ',';
+		firstField = false;
+		out += '"';
+		out += key;
+		out += "\":";
+	}
+
+	bool appendPositionJSON(std::string& out, const vg::Position& position)
+	{
+		bool first = true;
+		out += '{';
+		if (position.node_id() != 0)
+		{
+			appendJSONKey(out, first, "node_id");
+			out += '"';
+			appendSignedNumber(out, position.node_id());
+			out += '"';
+		}
+		if (position.offset() != 0)
+		{
+			appendJSONKey(out, first, "offset");
+			out += '"';
+			appendSignedNumber(out, position.offset());
+			out += '"';
+		}
+		if (position.is_reverse())
+		{
+			appendJSONKey(out, first, "is_reverse");
+			out += "true";
+		}
+		if (position.name().size() > 0)
+		{
+			appendJSONKey(out, first, "name");
+			if (!appendJSONString(out, position.name())) return false;
+		}
+		out += '}';
+		return true;
+	}
+
+	bool appendEditJSON(std::string& out, const vg::Edit& edit)
+	{
+		bool first = true;
+		out += '{';
+		if (edit.from_length() != 0)
+		{
+			appendJSONKey(out, first, "from_length");
+			appendSignedNumber(out, edit.from_length());
+		}
+		if (edit.to_length() != 0)
+		{
+			appendJSONKey(out, first, "to_length");
+			appendSignedNumber(out, edit.to_length());
+		}
+		if (edit.sequence().size() > 0)
+		{
+			appendJSONKey(out, first, "sequence");
+			if (!appendJSONString(out, edit.sequence())) return false;
+		}
+		out += '}';
+		return true;
+	}
+
+	bool appendPathJSON(std::string& out, const vg::Path& path)
+	{
+		bool first = true;
+		out += '{';
+		if (path.name().size() > 0)
+		{
+			appendJSONKey(out, first, "name");
+			if (!appendJSONString(out, path.name())) return false;
+		}
+		if (path.mapping_size() > 0)
+		{
+			appendJSONKey(out, first, "mapping");
+			out += '[';
+			for (int i = 0; i < path.mapping_size(); i++)
+			{
+				const vg::Mapping& mapping = path.mapping(i);
+				if (i > 0) out += ',';
+				bool firstInMapping = true;
+				out += '{';
+				if (mapping.has_position())
+				{
+					appendJSONKey(out, firstInMapping, "position");
+					if (!appendPositionJSON(out, mapping.position())) return false;
+				}
+				if (mapping.edit_size() > 0)
+				{
+					appendJSONKey(out, firstInMapping, "edit");
+					out += '[';
+					for (int j = 0; j < mapping.edit_size(); j++)
+					{
+						if (j > 0) out += ',';
+						if (!appendEditJSON(out, mapping.edit(j))) return false;
+					}
+					out += ']';
+				}
+				if (mapping.rank() != 0)
+				{
+					appendJSONKey(out, firstInMapping, "rank");
+					out += '"';
+					appendSignedNumber(out, mapping.rank());
+					out += '"';
+				}
+				out += '}';
+			}
+			out += ']';
+		}
+		if (path.is_circular())
+		{
+			appendJSONKey(out, first, "is_circular");
+			out += "true";
+		}
+		if (path.length() != 0)
+		{
+			appendJSONKey(out, first, "length");
+			out += '"';
+			appendSignedNumber(out, path.length());
+			out += '"';
+		}
+		out += '}';
+		return true;
+	}
+
+	bool AppendAlignmentJSON(std::string& out, const vg::Alignment& alignment)
+	{
+		size_t oldSize = out.size();
+		bool first = true;
+		out += '{';
+		bool ok = true;
+		if (ok && alignment.sequence().size() > 0)
+		{
+			appendJSONKey(out, first, "sequence");
+			ok = appendJSONString(out, alignment.sequence());
+		}
+		if (ok && alignment.has_path())
+		{
+			appendJSONKey(out, first, "path");
+			ok = appendPathJSON(out, alignment.path());
+		}
+		if (ok && alignment.name().size() > 0)
+		{
+			appendJSONKey(out, first, "name");
+			ok = appendJSONString(out, alignment.name());
+		}
+		if (ok && alignment.score() != 0)
+		{
+			appendJSONKey(out, first, "score");
+			appendSignedNumber(out, alignment.score());
+		}
+		if (ok && alignment.query_position() != 0)
+		{
+			appendJSONKey(out, first, "query_position");
+			appendSignedNumber(out, alignment.query_position());
+		}
+		if (ok && alignment.identity() != 0)
+		{
+			appendJSONKey(out, first, "identity");
+			appendJSONDouble(out, alignment.identity());
+		}
+		if (!ok)
+		{
+			out.resize(oldSize);
+			return false;
+		}
+		out += '}';
+		return true;
+	}
+
 	void mergeGraphs(vg::Graph& graph, const vg::Graph& part)
 	{
 		for (int i = 0; i < part.node_size(); i++)
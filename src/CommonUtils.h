@@ -2,6 +2,7 @@
 #define CommonUtils_h
 
 #include <algorithm>
+#include <set>
 #include <functional>
 #include <string>
 #include <vector>
@@ -16,34 +17,86 @@ namespace CommonUtils
 	};
 	namespace inner
 	{
-		bool alignmentLengthCompare(const vg::Alignment* const left, const vg::Alignment* const right);
-		bool alignmentScoreCompare(const vg::Alignment* const left, const vg::Alignment* const right);
-		bool alignmentIncompatible(const vg::Alignment* const left, const vg::Alignment* const right);
+		bool alignmentIncompatible(size_t leftStart, size_t leftEnd, size_t rightStart, size_t rightEnd);
 	}
 	vg::Graph LoadVGGraph(std::string filename);
 	char Complement(char original);
 	std::string ReverseComplement(std::string original);
 	vg::Alignment LoadVGAlignment(std::string filename);
 	std::vector<vg::Alignment> LoadVGAlignments(std::string filename);
-	template <typename T, typename F>
-	std::vector<T> SelectAlignments(std::vector<T> alignments, size_t maxnum, F alnGetter)
+	//appends the decimal digits of value without going through a stream or a temporary string
+	void AppendNumber(std::string& out, size_t value);
+	//appends the alignment as JSON the same way as protobuf's json printer with proto field names, without reflection.
+	//only the fields the aligner fills are written. returns false and leaves out unchanged if a string isn't ASCII, then use protobuf's printer
+	bool AppendAlignmentJSON(std::string& out, const vg::Alignment& alignment);
+	//picks the best alignments which don't overlap each others much. longer alignments are better, and lower scores between equally long ones.
+	//the getters give the read position where an alignment starts, the position after its end and its score.
+	//the candidates come longest first, so the overlap cutoff against every picked alignment depends only on the candidate's length.
+	//then only two picked alignments can decide whether a candidate fits: the one reaching furthest past the candidate's start among
+	//those starting before it, and the first one starting inside it. they are found with a prefix maximum tree and an ordered set
+	template <typename T, typename StartGetter, typename EndGetter, typename ScoreGetter>
+	std::vector<T> SelectAlignments(std::vector<T> alignments, size_t maxnum, StartGetter getStart, EndGetter getEnd, ScoreGetter getScore)
 	{
-		std::function<const vg::Alignment*(const T&)> f = [alnGetter](const T& aln) { return (const vg::Alignment*)alnGetter(aln); };
-		std::sort(alignments.begin(), alignments.end(), [f](const T& left, const T& right) { return inner::alignmentScoreCompare(f(left), f(right)); });
-		std::stable_sort(alignments.begin(), alignments.end(), [f](const T& left, const T& right) { return inner::alignmentLengthCompare(f(left), f(right)); });
 		std::vector<T> result;
-		assert(f(alignments[0])->sequence().size() > f(alignments.back())->sequence().size() || (f(alignments[0])->sequence().size() == f(alignments.back())->sequence().size() && f(alignments[0])->score() <= f(alignments.back())->score()));
+		if (alignments.size() == 0) return result;
+		auto length = [getStart, getEnd](const T& aln) { return (size_t)getEnd(aln) - (size_t)getStart(aln); };
+		std::sort(alignments.begin(), alignments.end(), [getScore](const T& left, const T& right) { return getScore(left) < getScore(right); });
+		std::stable_sort(alignments.begin(), alignments.end(), [length](const T& left, const T& right) { return length(left) > length(right); });
+		assert(length(alignments[0]) > length(alignments.back()) || (length(alignments[0]) == length(alignments.back()) && getScore(alignments[0]) <= getScore(alignments.back())));
+		std::vector<size_t> starts;
+		starts.reserve(alignments.size());
+		for (const auto& aln : alignments) starts.push_back(getStart(aln));
+		std::sort(starts.begin(), starts.end());
+		starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+		//fenwick tree of the picked alignment with the furthest end among those starting at or before a position, as (end, start)
+		std::vector<std::pair<size_t, size_t>> furthestEnd;
+		std::vector<bool> hasPicked;
+		furthestEnd.resize(starts.size()+1, std::make_pair(0, 0));
+		hasPicked.resize(starts.size()+1, false);
+		std::set<size_t> pickedStarts;
 		for (size_t i = 0; i < alignments.size(); i++)
 		{
-			const vg::Alignment* const aln = f(alignments[i]);
-			if (!std::any_of(result.begin(), result.end(), [aln, f](const T& existing) { return inner::alignmentIncompatible(f(existing), aln); }))
+			size_t start = getStart(alignments[i]);
+			size_t end = getEnd(alignments[i]);
+			size_t startIndex = std::lower_bound(starts.begin(), starts.end(), start) - starts.begin() + 1;
+			bool incompatible = false;
+			bool found = false;
+			std::pair<size_t, size_t> before { 0, 0 };
+			for (size_t j = startIndex; j > 0; j -= j & -j)
+			{
+				if (!hasPicked[j]) continue;
+				if (!found || furthestEnd[j].first > before.first) before = furthestEnd[j];
+				found = true;
+			}
+			if (found) incompatible = inner::alignmentIncompatible(before.second, before.first, start, end);
+			if (!incompatible)
+			{
+				auto inside = pickedStarts.upper_bound(start);
+				//the end doesn't matter for how much a picked alignment starting inside the candidate overlaps it, and its length is at least the candidate's
+				if (inside != pickedStarts.end()) incompatible = inner::alignmentIncompatible(*inside, *inside + (end - start), start, end);
+			}
+			if (!incompatible)
 			{
+				for (size_t j = startIndex; j < furthestEnd.size(); j += j & -j)
+				{
+					if (!hasPicked[j] || end > furthestEnd[j].first) furthestEnd[j] = std::make_pair(end, start);
+					hasPicked[j] = true;
+				}
+				pickedStarts.insert(start);
 				result.emplace_back(std::move(alignments[i]));
 			}
 			if (result.size() == maxnum) break;
 		}
 		return result;
 	}
+	template <typename T, typename F>
+	std::vector<T> SelectAlignments(std::vector<T> alignments, size_t maxnum, F alnGetter)
+	{
+		auto start = [alnGetter](const T& aln) { assert(alnGetter(aln)->query_position() >= 0); return (size_t)alnGetter(aln)->query_position(); };
+		auto end = [alnGetter](const T& aln) { return (size_t)alnGetter(aln)->query_position() + alnGetter(aln)->sequence().size(); };
+		auto score = [alnGetter](const T& aln) { return alnGetter(aln)->score(); };
+		return SelectAlignments(std::move(alignments), maxnum, start, end, score);
+	}
 	std::vector<vg::Alignment> SelectAlignments(std::vector<vg::Alignment> alns, size_t maxnum);
 	std::vector<vg::Alignment*> SelectAlignments(std::vector<vg::Alignment*> alns, size_t maxnum);
 }
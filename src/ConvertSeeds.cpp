@@ -0,0 +1,35 @@
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include "FileSeeder.h"
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "usage: ConvertSeeds in.gam out.seeds" << std::endl;
+		std::exit(1);
+	}
+	std::string infile { argv[1] };
+	std::string outfile { argv[2] };
+
+	//group the seeds by read name, keeping the reads in the order they first appear
+	std::vector<std::string> readOrder;
+	std::unordered_map<std::string, std::vector<SeedHit>> seeds;
+	size_t numSeeds = 0;
+	SeedFile::ForEachSeedGroup(infile, [&readOrder, &seeds, &numSeeds](std::string& readName, std::vector<SeedHit>& groupSeeds)
+	{
+		if (seeds.count(readName) == 0) readOrder.push_back(readName);
+		auto& readSeeds = seeds[readName];
+		readSeeds.insert(readSeeds.end(), groupSeeds.begin(), groupSeeds.end());
+		numSeeds += groupSeeds.size();
+	});
+
+	std::ofstream resultFile { outfile, std::ios::out | std::ios::binary };
+	SeedFile::WriteBinaryHeader(resultFile);
+	for (const auto& readName : readOrder)
+	{
+		SeedFile::WriteBinarySeedGroup(resultFile, readName, seeds.at(readName));
+	}
+	std::cerr << numSeeds << " seeds for " << readOrder.size() << " reads" << std::endl;
+}
@@ -10,62 +10,66 @@
 #include "CommonUtils.h"
 #include "fastqloader.h"
 #include "ReadCorrection.h"
+#include "BinaryAlignment.h"
 
-std::string toLower(std::string seq);
-
-void addPartial(const std::unordered_map<int, int>& ids, std::unordered_map<std::string, std::vector<Correction>>& partials, std::function<std::string(int)> seqGetter, const vg::Alignment& v)
+void addPartial(const std::unordered_map<int, int>& ids, std::unordered_map<std::string, std::vector<Correction>>& partials, std::function<std::string(int)> seqGetter, const BinaryAlignment::Record& v)
 {
 	Correction result;
-	result.startIndex = v.query_position();
-	result.endIndex = v.query_position() + v.sequence().size();
+	result.startIndex = v.queryStart;
+	result.endIndex = v.queryEnd;
 	result.corrected = "";
-	for (int i = 0; i < v.path().mapping_size(); i++)
+	for (const auto& step : v.path)
 	{
-		auto nodeid = v.path().mapping(i).position().node_id();
-		auto sequence = seqGetter(ids.at(nodeid));
-		int len = 0;
-		for (int j = 0; j < v.path().mapping(i).edit_size(); j++)
-		{
-			len += v.path().mapping(i).edit(j).from_length();
-		}
-		if (v.path().mapping(i).position().is_reverse())
+		auto sequence = seqGetter(ids.at(step.nodeId));
+		if (step.reverse)
 		{
 			sequence = CommonUtils::ReverseComplement(sequence);
 		}
-		if (v.path().mapping(i).position().offset() > 0)
+		if (step.offset > 0)
 		{
-			sequence = sequence.substr(v.path().mapping(i).position().offset());
+			sequence = sequence.substr(step.offset);
 		}
-		sequence = sequence.substr(0, len);
+		sequence = sequence.substr(0, step.graphLength);
 		result.corrected += sequence;
 	}
-	partials[v.name()].push_back(result);
+	partials[v.name].push_back(result);
 }
 
-void addPartial(const vg::Graph& g, const std::unordered_map<int, int>& ids, const vg::Alignment& v, std::unordered_map<std::string, std::vector<Correction>>& partials)
+void addPartial(const vg::Graph& g, const std::unordered_map<int, int>& ids, const BinaryAlignment::Record& v, std::unordered_map<std::string, std::vector<Correction>>& partials)
 {
 	addPartial(ids, partials, [&g](int id) {return g.node(id).sequence();}, v);
 }
 
-void addPartial(const GfaGraph& g, const std::unordered_map<int, int>& ids, const vg::Alignment& v, std::unordered_map<std::string, std::vector<Correction>>& partials)
+void addPartial(const GfaGraph& g, const std::unordered_map<int, int>& ids, const BinaryAlignment::Record& v, std::unordered_map<std::string, std::vector<Correction>>& partials)
 {
 	addPartial(ids, partials, [&g](int id) {return g.nodes.at(id);}, v);
 }
 
 void mergePartials(const std::unordered_map<std::string, std::vector<Correction>>& partials, const std::vector<FastQ>& reads, size_t maxOverlap)
 {
-	for (auto read : reads)
+	std::string buffer;
+	std::vector<Correction> noCorrections;
+	for (const auto& read : reads)
 	{
-		if (partials.count(read.seq_id) == 0)
+		buffer.clear();
+		buffer += '>';
+		buffer += read.seq_id;
+		buffer += '\n';
+		auto found = partials.find(read.seq_id);
+		if (found == partials.end())
+		{
+			appendCorrected(buffer, read.sequence, noCorrections, maxOverlap);
+		}
+		else
 		{
-			std::cout << ">" << read.seq_id << std::endl << toLower(read.sequence) << std::endl;
-			continue;
+			auto p = found->second;
+			std::sort(p.begin(), p.end(), [](const Correction& left, const Correction& right) { return left.startIndex < right.startIndex; });
+			appendCorrected(buffer, read.sequence, p, maxOverlap);
 		}
-		auto p = partials.at(read.seq_id);
-		std::sort(p.begin(), p.end(), [](const Correction& left, const Correction& right) { return left.startIndex < right.startIndex; });
-		auto corrected = getCorrected(read.sequence, p, maxOverlap);
-		std::cout << ">" << read.seq_id << std::endl << corrected << std::endl;
+		buffer += '\n';
+		std::cout.write(buffer.data(), buffer.size());
 	}
+	std::cout << std::flush;
 }
 
 int main(int argc, char** argv)
@@ -92,13 +96,9 @@ int main(int argc, char** argv)
 		{
 			ids[graph.node(i).id()] = i;
 		}
-		{
-			std::ifstream alnfile { argv[2], std::ios::in | std::ios::binary };
-			std::function<void(vg::Alignment&)> lambda = [&graph, &ids, &partials](vg::Alignment& aln) {
-				addPartial(graph, ids, aln, partials);
-			};
-			stream::for_each(alnfile, lambda);
-		}
+		BinaryAlignment::ForEachRecord(alnfilename, [&graph, &ids, &partials](const BinaryAlignment::Record& aln) {
+			addPartial(graph, ids, aln, partials);
+		});
 	}
 	else if (graphfilename.substr(graphfilename.size() - 4) == ".gfa")
 	{
@@ -109,13 +109,9 @@ int main(int argc, char** argv)
 		{
 			ids[node.first] = node.first;
 		}
-		{
-			std::ifstream alnfile { argv[2], std::ios::in | std::ios::binary };
-			std::function<void(vg::Alignment&)> lambda = [&graph, &ids, &partials](vg::Alignment& aln) {
-				addPartial(graph, ids, aln, partials);
-			};
-			stream::for_each(alnfile, lambda);
-		}
+		BinaryAlignment::ForEachRecord(alnfilename, [&graph, &ids, &partials](const BinaryAlignment::Record& aln) {
+			addPartial(graph, ids, aln, partials);
+		});
 	}
 
 
@@ -0,0 +1,273 @@
+#include <cstring>
+#include <stdexcept>
+#include <zstr.hpp> //https://github.com/mateidavid/zstr
+#include "FileSeeder.h"
+#include "vg.pb.h"
+#include "stream.hpp"
+
+const char SeedFileMagic[8] = { 'G', 'A', 'S', 'E', 'E', 'D', 'S', 1 };
+
+bool readVarint(std::istream& in, uint64_t& result)
+{
+	result = 0;
+	for (size_t shift = 0; shift < 64; shift += 7)
+	{
+		int c = in.get();
+		if (c == EOF) return false;
+		result |= (uint64_t)(c & 0x7F) << shift;
+		if ((c & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+void writeVarint(std::ostream& out, uint64_t value)
+{
+	char buf[10];
+	size_t length = 0;
+	while (value >= 0x80)
+	{
+		buf[length] = (char)((value & 0x7F) | 0x80);
+		length++;
+		value >>= 7;
+	}
+	buf[length] = (char)value;
+	length++;
+	out.write(buf, length);
+}
+
+uint64_t zigzagEncode(int64_t value)
+{
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t zigzagDecode(uint64_t value)
+{
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+void brokenSeedFile(const std::string& filename)
+{
+	std::cerr << "Seed file " << filename << " is truncated or corrupted" << std::endl;
+	std::exit(1);
+}
+
+void seedsOutOfOrder(const std::string& skippedRead, const std::string& readName)
+{
+	std::cerr << "The seeds of read " << skippedRead << " come before the seeds of read " << readName << " in the seed files, but the read is not in the input before " << readName << ". The seed files must be grouped by read name in the same order as the reads when streaming seeds" << std::endl;
+	std::exit(1);
+}
+
+void forEachBinarySeedGroup(const std::string& filename, std::function<void(std::string&, std::vector<SeedHit>&)> callback)
+{
+	zstr::ifstream file { filename };
+	char magic[8];
+	file.read(magic, 8);
+	if (!file.good() || memcmp(magic, SeedFileMagic, 8) != 0) throw std::runtime_error { filename + " is not a binary seed file" };
+	std::string readName;
+	std::vector<SeedHit> seeds;
+	uint64_t nameLength;
+	while (readVarint(file, nameLength))
+	{
+		readName.resize(nameLength);
+		file.read(&readName[0], nameLength);
+		uint64_t seedCount;
+		if (!file.good() || !readVarint(file, seedCount)) brokenSeedFile(filename);
+		seeds.clear();
+		seeds.reserve(seedCount);
+		for (uint64_t i = 0; i < seedCount; i++)
+		{
+			uint64_t nodeID, offsetAndReverse, seqPos, matchLen;
+			if (!readVarint(file, nodeID)) brokenSeedFile(filename);
+			if (!readVarint(file, offsetAndReverse)) brokenSeedFile(filename);
+			if (!readVarint(file, seqPos)) brokenSeedFile(filename);
+			if (!readVarint(file, matchLen)) brokenSeedFile(filename);
+			seeds.emplace_back(zigzagDecode(nodeID), offsetAndReverse >> 1, seqPos, matchLen, offsetAndReverse & 1);
+		}
+		callback(readName, seeds);
+	}
+}
+
+void forEachGAMSeedGroup(const std::string& filename, std::function<void(std::string&, std::vector<SeedHit>&)> callback)
+{
+	std::ifstream seedfile { filename, std::ios::in | std::ios::binary };
+	std::string readName;
+	std::vector<SeedHit> seeds;
+	std::function<void(vg::Alignment&)> alignmentLambda = [&readName, &seeds, callback](vg::Alignment& seedhit) {
+		if (seeds.size() > 0 && seedhit.name() != readName)
+		{
+			callback(readName, seeds);
+			seeds.clear();
+		}
+		readName = seedhit.name();
+		seeds.emplace_back(seedhit.path().mapping(0).position().node_id(), seedhit.path().mapping(0).position().offset(), seedhit.query_position(), seedhit.path().mapping(0).edit(0).from_length(), seedhit.path().mapping(0).position().is_reverse());
+	};
+	stream::for_each(seedfile, alignmentLambda);
+	if (seeds.size() > 0) callback(readName, seeds);
+}
+
+namespace SeedFile
+{
+	bool IsBinarySeedFile(const std::string& filename)
+	{
+		zstr::ifstream file { filename };
+		char magic[8];
+		file.read(magic, 8);
+		return file.good() && memcmp(magic, SeedFileMagic, 8) == 0;
+	}
+
+	void ForEachSeedGroup(const std::string& filename, std::function<void(std::string&, std::vector<SeedHit>&)> callback)
+	{
+		if (IsBinarySeedFile(filename))
+		{
+			forEachBinarySeedGroup(filename, callback);
+		}
+		else
+		{
+			forEachGAMSeedGroup(filename, callback);
+		}
+	}
+
+	void WriteBinaryHeader(std::ostream& out)
+	{
+		out.write(SeedFileMagic, 8);
+	}
+
+	void WriteBinarySeedGroup(std::ostream& out, const std::string& readName, const std::vector<SeedHit>& seeds)
+	{
+		writeVarint(out, readName.size());
+		out.write(readName.data(), readName.size());
+		writeVarint(out, seeds.size());
+		for (const auto& seed : seeds)
+		{
+			writeVarint(out, zigzagEncode(seed.nodeID));
+			writeVarint(out, (seed.nodeOffset << 1) | (seed.reverse ? 1 : 0));
+			writeVarint(out, seed.seqPos);
+			writeVarint(out, seed.matchLen);
+		}
+	}
+}
+
+FileSeeder::FileSeeder(const std::vector<std::string>& files, bool streaming) :
+files(files),
+streaming(streaming),
+seedCount(0),
+seeds(),
+seedsMutex(),
+pendingGroups(),
+pendingNames(),
+pendingMutex(),
+pendingChanged(),
+loaderFinished(false),
+stopLoader(false),
+unmatchedGroups(0),
+loaderThread()
+{
+	if (streaming)
+	{
+		loaderThread = std::thread { [this]() { streamSeedFiles(); } };
+		return;
+	}
+	for (const auto& file : files)
+	{
+		SeedFile::ForEachSeedGroup(file, [this](std::string& readName, std::vector<SeedHit>& groupSeeds)
+		{
+			seedCount += groupSeeds.size();
+			auto& readSeeds = seeds[readName];
+			readSeeds.insert(readSeeds.end(), groupSeeds.begin(), groupSeeds.end());
+		});
+	}
+}
+
+FileSeeder::~FileSeeder()
+{
+	if (loaderThread.joinable()) finishStreaming();
+}
+
+void FileSeeder::streamSeedFiles()
+{
+	for (const auto& file : files)
+	{
+		SeedFile::ForEachSeedGroup(file, [this](std::string& readName, std::vector<SeedHit>& groupSeeds)
+		{
+			seedCount += groupSeeds.size();
+			std::unique_lock<std::mutex> lock { pendingMutex };
+			pendingChanged.wait(lock, [this]() { return stopLoader || pendingGroups.size() < MaxPendingGroups; });
+			if (stopLoader)
+			{
+				unmatchedGroups += 1;
+				return;
+			}
+			pendingNames[readName] += 1;
+			pendingGroups.emplace_back(readName, std::move(groupSeeds));
+			pendingChanged.notify_all();
+		});
+	}
+	std::lock_guard<std::mutex> lock { pendingMutex };
+	loaderFinished = true;
+	pendingChanged.notify_all();
+}
+
+void FileSeeder::prepareSeeds(const std::string& readName)
+{
+	if (!streaming) return;
+	std::vector<SeedHit> readSeeds;
+	{
+		std::unique_lock<std::mutex> lock { pendingMutex };
+		//reads without seeds are simply missing from the seed file, so look ahead a window of groups before deciding that this read has none
+		pendingChanged.wait(lock, [this, &readName]() { return loaderFinished || pendingGroups.size() >= MaxPendingGroups || pendingNames.count(readName) == 1; });
+		if (pendingNames.count(readName) == 0) return;
+		//the groups before this read's group can't match any later read, so the seed file is not in read order
+		if (pendingGroups.front().first != readName) seedsOutOfOrder(pendingGroups.front().first, readName);
+		while (pendingGroups.size() > 0 && pendingGroups.front().first == readName)
+		{
+			readSeeds.insert(readSeeds.end(), pendingGroups.front().second.begin(), pendingGroups.front().second.end());
+			pendingGroups.pop_front();
+		}
+		pendingNames.erase(readName);
+		pendingChanged.notify_all();
+	}
+	if (readSeeds.size() == 0) return;
+	std::lock_guard<std::mutex> lock { seedsMutex };
+	auto& inFlight = seeds[readName];
+	inFlight.insert(inFlight.end(), readSeeds.begin(), readSeeds.end());
+}
+
+void FileSeeder::finishStreaming()
+{
+	if (!loaderThread.joinable()) return;
+	{
+		std::lock_guard<std::mutex> lock { pendingMutex };
+		stopLoader = true;
+		unmatchedGroups += pendingGroups.size();
+		pendingGroups.clear();
+		pendingNames.clear();
+		pendingChanged.notify_all();
+	}
+	loaderThread.join();
+	if (unmatchedGroups > 0)
+	{
+		std::cerr << unmatchedGroups << " reads in the seed files were not matched to the input reads. The seed files must be grouped by read name in the same order as the reads when streaming seeds" << std::endl;
+	}
+}
+
+std::vector<SeedHit> FileSeeder::getSeeds(const std::string& readName) const
+{
+	if (!streaming)
+	{
+		//all seeds were loaded up front and are only read from here on
+		auto found = seeds.find(readName);
+		if (found == seeds.end()) return std::vector<SeedHit>{};
+		return found->second;
+	}
+	std::lock_guard<std::mutex> lock { seedsMutex };
+	auto found = seeds.find(readName);
+	if (found == seeds.end()) return std::vector<SeedHit>{};
+	std::vector<SeedHit> result = std::move(found->second);
+	seeds.erase(found);
+	return result;
+}
+
+size_t FileSeeder::numSeeds() const
+{
+	return seedCount;
+}
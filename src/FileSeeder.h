@@ -0,0 +1,66 @@
+#ifndef FileSeeder_h
+#define FileSeeder_h
+
+#include <vector>
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <iostream>
+#include "GraphAlignerWrapper.h"
+
+//compact binary seed file:
+//magic "GASEEDS" + version byte, then one record per read:
+//varint name length, name, varint seed count, and per seed varints of
+//zigzag node id, (node offset << 1) | reverse, read position and match length
+//the file may be gzipped
+namespace SeedFile
+{
+	bool IsBinarySeedFile(const std::string& filename);
+	//calls callback once per consecutive run of seeds with the same read name, in file order
+	void ForEachSeedGroup(const std::string& filename, std::function<void(std::string&, std::vector<SeedHit>&)> callback);
+	void WriteBinaryHeader(std::ostream& out);
+	void WriteBinarySeedGroup(std::ostream& out, const std::string& readName, const std::vector<SeedHit>& seeds);
+}
+
+class FileSeeder
+{
+public:
+	//streaming: the seed files are grouped by read name in the same order as the reads,
+	//and only the seeds of reads in flight are kept in memory
+	FileSeeder(const std::vector<std::string>& files, bool streaming);
+	~FileSeeder();
+	FileSeeder(const FileSeeder& other) = delete;
+	FileSeeder& operator=(const FileSeeder& other) = delete;
+	//called by the read streamer for each read in input order before the read is given to the aligner threads
+	void prepareSeeds(const std::string& readName);
+	//called by the read streamer after the last read
+	void finishStreaming();
+	std::vector<SeedHit> getSeeds(const std::string& readName) const;
+	size_t numSeeds() const;
+private:
+	void streamSeedFiles();
+	std::vector<std::string> files;
+	bool streaming;
+	std::atomic<size_t> seedCount;
+	//loaded seeds, either all of them or the ones prepared for reads in flight
+	mutable std::unordered_map<std::string, std::vector<SeedHit>> seeds;
+	mutable std::mutex seedsMutex;
+	//seed groups read by the loader thread but not yet matched to a read
+	std::deque<std::pair<std::string, std::vector<SeedHit>>> pendingGroups;
+	//number of pending groups per read name
+	std::unordered_map<std::string, size_t> pendingNames;
+	std::mutex pendingMutex;
+	std::condition_variable pendingChanged;
+	bool loaderFinished;
+	bool stopLoader;
+	size_t unmatchedGroups;
+	std::thread loaderThread;
+	static constexpr size_t MaxPendingGroups = 1000;
+};
+
+#endif
@@ -201,7 +201,7 @@ void addBestAlnsOnePair(std::unordered_map<std::string, FusionAlignment>& bestAl
 		try
 		{
 			auto alignments = AlignOneWay(alignmentGraph, read.seq_id, read.sequence, 500, 500, true, reusableState, true, true, false);
-			AddAlignment(read.seq_id, read.sequence, alignments.alignments[0]);
+			AddAlignment(read.seq_id, read.sequence, alignments.alignments[0], nullptr);
 			replaceDigraphNodeIdsWithOriginalNodeIds(*alignments.alignments[0].alignment, alignmentGraph);
 			if (alignments.alignments[0].alignment->score() > read.sequence.size() * maxScoreFraction) continue;
 			int leftAlnSize = 0;
@@ -473,7 +473,7 @@ std::unordered_map<std::string, std::unordered_set<size_t>> getExtraGeneMatches(
 		fakeGraph.nodes[nameMapping.size()] = transcript.sequence();
 		nameMapping.push_back(geneFromTranscript(transcript.name()));
 	}
-	auto seeder = MummerSeeder(fakeGraph, "");
+	MummerSeeder seeder { fakeGraph, "", 1 };
 	std::unordered_map<std::string, std::unordered_set<size_t>> result;
 	for (size_t i = 0; i < reads.size(); i++)
 	{
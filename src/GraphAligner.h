@@ -14,6 +14,8 @@
 #include "GraphAlignerVGAlignment.h"
 #include "GraphAlignerGAFAlignment.h"
 #include "GraphAlignerBitvectorBanded.h"
+#include "AlignmentTaskPool.h"
+#include "BinaryAlignment.h"
 
 template <typename LengthType, typename ScoreType, typename Word>
 class GraphAligner
@@ -31,6 +33,9 @@ private:
 	mutable BufferedWriter logger;
 	using AlignerGraphsizedState = typename Common::AlignerGraphsizedState;
 	using TraceItem = typename Common::TraceItem;
+	using CompactTraceBuilder = typename Common::CompactTraceBuilder;
+	using ReverseCompactTraceBuilder = typename Common::ReverseCompactTraceBuilder;
+	using CompactTrace = typename Common::CompactTrace;
 	const Params& params;
 public:
 
@@ -53,16 +58,15 @@ public:
 		size_t time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
 		//failed alignment, don't output
 		if (trace.score == std::numeric_limits<ScoreType>::max()) return result;
-		if (trace.trace.size() == 0) return result;
-#ifndef NDEBUG
-		if (trace.trace.size() > 0) verifyTrace(trace.trace, sequence, trace.score);
-#endif
-		fixForwardTraceSeqPos(trace.trace, 0, sequence);
+		if (trace.numCells == 0) return result;
 
-		AlignmentResult::AlignmentItem alnItem { std::move(trace), 0, std::numeric_limits<size_t>::max() };
+		CompactTraceBuilder compact;
+		compact.setScore(trace.score);
+		compact.append(std::move(trace));
+		AlignmentResult::AlignmentItem alnItem { compact.get(), 0, std::numeric_limits<size_t>::max() };
 
-		alnItem.alignmentStart = alnItem.trace->trace[0].DPposition.seqPos;
-		alnItem.alignmentEnd = alnItem.trace->trace.back().DPposition.seqPos;
+		alnItem.alignmentStart = alnItem.trace->runs[0].seqPos;
+		alnItem.alignmentEnd = alnItem.trace->runs.back().lastSeqPos();
 		timeEnd = std::chrono::system_clock::now();
 		time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
 		alnItem.elapsedMilliseconds = time;
@@ -70,32 +74,24 @@ public:
 		return result;
 	}
 
-	AlignmentResult AlignOneWay(const std::string& seq_id, const std::string& sequence, const std::vector<SeedHit>& seedHits, AlignerGraphsizedState& reusableState) const
+	AlignmentResult AlignOneWay(const std::string& seq_id, const std::string& sequence, const std::vector<SeedHit>& seedHits, AlignerGraphsizedState& reusableState, AlignmentTaskPool* taskPool) const
 	{
 		assert(params.graph.finalized);
+		if (taskPool != nullptr) return alignSeedsInParallel(seq_id, sequence, seedHits, reusableState, *taskPool);
 		AlignmentResult result;
 		result.readName = seq_id;
 		assert(seedHits.size() > 0);
 		// std::vector<std::tuple<size_t, size_t, size_t>> triedAlignmentNodes;
 		for (size_t i = 0; i < seedHits.size(); i++)
 		{
-			std::string seedInfo = std::to_string(seedHits[i].nodeID) + (seedHits[i].reverse ? "-" : "+") + "," + std::to_string(seedHits[i].seqPos) + "," + std::to_string(seedHits[i].matchLen) + "," + std::to_string(seedHits[i].nodeOffset);
+			std::string seedInfo = getSeedInfo(seedHits[i]);
 			logger << seq_id << " seed " << i << "/" << seedHits.size() << " " << seedInfo;
 			assertSetRead(seq_id, seedInfo);
-			if (params.sloppyOptimizations)
+			if (params.sloppyOptimizations && seedInsideAlignment(result, seedHits[i]))
 			{
-				bool found = false;
-				for (const auto& aln : result.alignments)
-				{
-					if (aln.alignmentStart <= seedHits[i].seqPos && aln.alignmentEnd >= seedHits[i].seqPos)
-					{
-						logger << " skipped";
-						logger << BufferedWriter::Flush;
-						found = true;
-						break;
-					}
-				}
-				if (found) continue;
+				logger << " skipped";
+				logger << BufferedWriter::Flush;
+				continue;
 			}
 			logger << BufferedWriter::Flush;
 			result.seedsExtended += 1;
@@ -108,125 +104,360 @@ public:
 		return result;
 	}
 
-	void AddAlignment(const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment)
+	void AddAlignment(const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment, google::protobuf::Arena* arena)
 	{
-		assert(alignment.trace->trace.size() > 0);
-		auto vgAln = VGAlignment::traceToAlignment(seq_id, sequence, alignment.trace->score, alignment.trace->trace, 0, false);
+		assert(alignment.trace->runs.size() > 0);
+		auto vgAln = VGAlignment::traceToAlignment(seq_id, sequence, *alignment.trace, arena);
 		alignment.alignment = vgAln;
 		alignment.alignment->set_sequence(sequence.substr(alignment.alignmentStart, alignment.alignmentEnd - alignment.alignmentStart));
 		alignment.alignment->set_query_position(alignment.alignmentStart);
 	}
 
-	void AddGAFLine(const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment)
+	void AppendGAFLine(const std::string& seq_id, const std::string& sequence, const AlignmentResult::AlignmentItem& alignment, std::string& out) const
+	{
+		assert(alignment.trace->runs.size() > 0);
+		GAFAlignment::appendAlignment(out, seq_id, sequence.size(), *alignment.trace, params);
+	}
+
+	//the only place where a record's digraph node ids become input graph ids, see BinaryAlignment.h
+	void AppendBinaryRecord(const std::string& seq_id, const AlignmentResult::AlignmentItem& alignment, std::string& out) const
 	{
-		assert(alignment.trace->trace.size() > 0);
-		alignment.GAFline = GAFAlignment::traceToAlignment(seq_id, sequence, *alignment.trace, params);
+		assert(alignment.trace->runs.size() > 0);
+		const auto& runs = alignment.trace->runs;
+		assert(runs[0].newNode);
+		thread_local BinaryAlignment::Record record;
+		record.name = seq_id;
+		record.queryStart = alignment.alignmentStart;
+		record.queryEnd = alignment.alignmentEnd;
+		record.score = alignment.trace->score;
+		record.path.clear();
+		for (const auto& run : runs)
+		{
+			if (run.newNode)
+			{
+				record.path.emplace_back();
+				record.path.back().nodeId = run.node / 2;
+				record.path.back().reverse = (run.node % 2) == 1;
+				record.path.back().offset = run.nodeOffset;
+				record.path.back().graphLength = 0;
+				record.path.back().readLength = 0;
+			}
+			if (run.type != CompactTrace::Insertion) record.path.back().graphLength += run.length;
+			if (run.type != CompactTrace::Deletion) record.path.back().readLength += run.length;
+		}
+		BinaryAlignment::AppendRecord(out, record);
 	}
 
-	void AddCorrected(AlignmentResult::AlignmentItem& alignment)
+	//the corrected read is the graph sequence along the alignment. runs of insertions have no graph sequence
+	void AddCorrected(AlignmentResult::AlignmentItem& alignment) const
 	{
 		assert(alignment.trace != nullptr);
-		assert(alignment.trace->trace.size() > 0);
-		alignment.corrected.reserve(alignment.trace->trace.back().DPposition.seqPos - alignment.trace->trace[0].DPposition.seqPos);
-		alignment.corrected = alignment.trace->trace[0].graphCharacter;
-		for (size_t i = 1; i < alignment.trace->trace.size(); i++)
+		assert(alignment.trace->runs.size() > 0);
+		alignment.corrected.clear();
+		for (const auto& run : alignment.trace->runs)
 		{
-			if (!alignment.trace->trace[i-1].nodeSwitch && alignment.trace->trace[i].DPposition.nodeOffset == alignment.trace->trace[i-1].DPposition.nodeOffset && alignment.trace->trace[i].DPposition.node == alignment.trace->trace[i-1].DPposition.node) continue;
-			alignment.corrected += alignment.trace->trace[i].graphCharacter;
+			if (run.type == CompactTrace::Insertion) continue;
+			size_t splitNode = params.graph.GetUnitigNode(run.node, run.nodeOffset);
+			for (size_t i = 0; i < run.length; i++)
+			{
+				size_t offset = run.nodeOffset + i;
+				if (offset >= params.graph.nodeOffset[splitNode] + params.graph.NodeLength(splitNode)) splitNode = params.graph.GetUnitigNode(run.node, offset);
+				alignment.corrected += params.graph.NodeSequences(splitNode, offset - params.graph.nodeOffset[splitNode]);
+			}
 		}
 	}
 
 private:
 
+	static bool seedInsideAlignment(const AlignmentResult& result, const SeedHit& seedHit)
+	{
+		for (const auto& aln : result.alignments)
+		{
+			if (aln.alignmentStart <= seedHit.seqPos && aln.alignmentEnd >= seedHit.seqPos) return true;
+		}
+		return false;
+	}
+
+	//same result as extending the seeds one by one. the forward and backward halves of the seed extensions are tasks in the task pool.
+	//the seeds are extended in rounds of one seed per thread, so only that many seeds' traces are in memory at once.
+	//with sloppy optimizations a seed is skipped if an earlier alignment covers it, and a seed which turns out
+	//to be covered by an alignment from an earlier seed in the same round is thrown away.
+	//the first seed often covers the whole read so then the first round has only one seed
+	AlignmentResult alignSeedsInParallel(const std::string& seq_id, const std::string& sequence, const std::vector<SeedHit>& seedHits, AlignerGraphsizedState& reusableState, AlignmentTaskPool& taskPool) const
+	{
+		AlignmentResult result;
+		result.readName = seq_id;
+		assert(seedHits.size() > 0);
+		std::vector<Trace> traces;
+		traces.resize(seedHits.size());
+		std::vector<bool> extended;
+		extended.resize(seedHits.size(), false);
+		std::vector<AlignmentTaskPool::Task> tasks;
+		size_t roundStart = 0;
+		while (roundStart < seedHits.size())
+		{
+			size_t roundSize = std::max<size_t>(taskPool.numWorkers(), 1);
+			if (params.sloppyOptimizations && roundStart == 0) roundSize = 1;
+			size_t roundEnd = roundStart;
+			size_t roundSeeds = 0;
+			tasks.clear();
+			while (roundEnd < seedHits.size() && roundSeeds < roundSize)
+			{
+				size_t i = roundEnd;
+				roundEnd++;
+				//covered by an alignment from an earlier round
+				if (params.sloppyOptimizations && seedInsideAlignment(result, seedHits[i])) continue;
+				roundSeeds += 1;
+				extended[i] = true;
+				std::string seedInfo = getSeedInfo(seedHits[i]);
+				traces[i].backward.score = std::numeric_limits<ScoreType>::max();
+				traces[i].forward.score = std::numeric_limits<ScoreType>::max();
+				if (seedHits[i].seqPos > 0)
+				{
+					tasks.emplace_back([this, &seq_id, &sequence, &seedHits, &traces, i, seedInfo](AlignerGraphsizedState& state)
+					{
+						assertSetRead(seq_id, seedInfo);
+						traces[i].backward = getBackwardTrace(sequence, seedHits[i], state);
+					});
+				}
+				if (seedHits[i].seqPos < sequence.size()-1)
+				{
+					tasks.emplace_back([this, &seq_id, &sequence, &seedHits, &traces, i, seedInfo](AlignerGraphsizedState& state)
+					{
+						assertSetRead(seq_id, seedInfo);
+						traces[i].forward = getForwardTrace(sequence, seedHits[i], state);
+					});
+				}
+			}
+			auto timeStart = std::chrono::system_clock::now();
+			taskPool.runTasks(tasks, reusableState);
+			for (size_t i = roundStart; i < roundEnd; i++)
+			{
+				std::string seedInfo = getSeedInfo(seedHits[i]);
+				logger << seq_id << " seed " << i << "/" << seedHits.size() << " " << seedInfo;
+				assertSetRead(seq_id, seedInfo);
+				if (params.sloppyOptimizations && seedInsideAlignment(result, seedHits[i]))
+				{
+					logger << " skipped";
+					logger << BufferedWriter::Flush;
+					traces[i] = Trace {};
+					continue;
+				}
+				assert(extended[i]);
+				logger << BufferedWriter::Flush;
+				result.seedsExtended += 1;
+				auto item = alignmentFromTrace(sequence, std::move(traces[i]), timeStart);
+				traces[i] = Trace {};
+				if (item.alignmentFailed()) continue;
+				result.alignments.emplace_back(std::move(item));
+			}
+			roundStart = roundEnd;
+		}
+		assertSetRead(seq_id, "No seed");
+		return result;
+	}
+
+	static std::string getSeedInfo(const SeedHit& seedHit)
+	{
+		return std::to_string(seedHit.nodeID) + (seedHit.reverse ? "-" : "+") + "," + std::to_string(seedHit.seqPos) + "," + std::to_string(seedHit.matchLen) + "," + std::to_string(seedHit.nodeOffset);
+	}
+
 	OnewayTrace getBacktraceFullStart(const std::string& sequence, AlignerGraphsizedState& reusableState) const
 	{
-		return bvAligner.getBacktraceFullStart(sequence, params.forceGlobal, reusableState);
+		ForwardTraceCells cells { *this, sequence, 1 };
+		auto score = bvAligner.getBacktraceFullStart(sequence, params.forceGlobal, reusableState, cells);
+		if (score == std::numeric_limits<ScoreType>::max()) return OnewayTrace::TraceFailed();
+		auto result = cells.get();
+		assert(result.firstCells[0].DPposition.seqPos == 0);
+		result.score = score;
+		return result;
+	}
+
+	static int forwardNodeId(const SeedHit& seedHit)
+	{
+		return seedHit.reverse ? seedHit.nodeID * 2 + 1 : seedHit.nodeID * 2;
+	}
+
+	static int backwardNodeId(const SeedHit& seedHit)
+	{
+		return seedHit.reverse ? seedHit.nodeID * 2 : seedHit.nodeID * 2 + 1;
+	}
+
+	//the two halves are independent so they can be calculated on different threads
+	OnewayTrace getBackwardTrace(const std::string& sequence, const SeedHit& seedHit, AlignerGraphsizedState& reusableState) const
+	{
+		assert(seedHit.seqPos > 0);
+		assert(seedHit.seqPos < sequence.size());
+		auto backwardPart = CommonUtils::ReverseComplement(sequence.substr(0, seedHit.seqPos));
+		auto reversePos = params.graph.GetReversePosition(forwardNodeId(seedHit), seedHit.nodeOffset);
+		assert(reversePos.first == backwardNodeId(seedHit));
+		BackwardTraceCells cells { *this, sequence, seedHit.seqPos-1 };
+		auto score = bvAligner.getReverseTraceFromSeed(backwardPart, backwardNodeId(seedHit), reversePos.second, params.forceGlobal, reusableState, cells);
+		if (score == std::numeric_limits<ScoreType>::max()) return OnewayTrace::TraceFailed();
+		assert(cells.lastFound().seqPos == (size_t)-1 && params.graph.nodeIDs[cells.lastFound().node] == backwardNodeId(seedHit) && params.graph.nodeOffset[cells.lastFound().node] + cells.lastFound().nodeOffset == reversePos.second);
+		auto result = cells.get();
+		result.score = score;
+		return result;
+	}
+
+	OnewayTrace getForwardTrace(const std::string& sequence, const SeedHit& seedHit, AlignerGraphsizedState& reusableState) const
+	{
+		assert(seedHit.seqPos < sequence.size()-1);
+		auto forwardPart = sequence.substr(seedHit.seqPos+1);
+		size_t offset = seedHit.nodeOffset;
+		ForwardTraceCells cells { *this, sequence, seedHit.seqPos+1 };
+		auto score = bvAligner.getReverseTraceFromSeed(forwardPart, forwardNodeId(seedHit), offset, params.forceGlobal, reusableState, cells);
+		if (score == std::numeric_limits<ScoreType>::max()) return OnewayTrace::TraceFailed();
+		assert(cells.lastFound().seqPos == (size_t)-1 && params.graph.nodeIDs[cells.lastFound().node] == forwardNodeId(seedHit) && params.graph.nodeOffset[cells.lastFound().node] + cells.lastFound().nodeOffset == seedHit.nodeOffset);
+		auto result = cells.get();
+		result.score = score;
+		return result;
 	}
 
 	Trace getTwoDirectionalTrace(const std::string& sequence, SeedHit seedHit, AlignerGraphsizedState& reusableState) const
 	{
 		assert(seedHit.seqPos >= 0);
 		assert(seedHit.seqPos < sequence.size());
-		int forwardNodeId;
-		int backwardNodeId;
-		if (seedHit.reverse)
-		{
-			forwardNodeId = seedHit.nodeID * 2 + 1;
-			backwardNodeId = seedHit.nodeID * 2;
-		}
-		else
-		{
-			forwardNodeId = seedHit.nodeID * 2;
-			backwardNodeId = seedHit.nodeID * 2 + 1;
-		}
 		Trace result;
 		result.backward.score = std::numeric_limits<ScoreType>::max();
 		result.forward.score = std::numeric_limits<ScoreType>::max();
 		if (seedHit.seqPos > 0)
 		{
-			auto backwardPart = CommonUtils::ReverseComplement(sequence.substr(0, seedHit.seqPos));
-			auto reversePos = params.graph.GetReversePosition(forwardNodeId, seedHit.nodeOffset);
-			assert(reversePos.first == backwardNodeId);
-			result.backward = bvAligner.getReverseTraceFromSeed(backwardPart, backwardNodeId, reversePos.second, params.forceGlobal, reusableState);
+			result.backward = getBackwardTrace(sequence, seedHit, reusableState);
 		}
 		if (seedHit.seqPos < sequence.size()-1)
 		{
-			auto forwardPart = sequence.substr(seedHit.seqPos+1);
-			size_t offset = seedHit.nodeOffset;
-			result.forward = bvAligner.getReverseTraceFromSeed(forwardPart, forwardNodeId, offset, params.forceGlobal, reusableState);
+			result.forward = getForwardTrace(sequence, seedHit, reusableState);
 		}
+		return result;
+	}
 
-		if (!result.backward.failed())
+	//the backtrace of the forward direction finds the cells from the end of the read back towards the seed.
+	//they are moved to the original graph and the read's positions and compacted as they are found
+	class ForwardTraceCells
+	{
+	public:
+		ForwardTraceCells(const GraphAligner& aligner, const std::string& sequence, LengthType start) :
+		aligner(aligner),
+		sequence(sequence),
+		start(start),
+		compact(),
+		pending(),
+		found(0, 0, 0),
+		anyFound(false)
 		{
-			auto reversePos = params.graph.GetReversePosition(forwardNodeId, seedHit.nodeOffset);
-			assert(result.backward.trace.back().DPposition.seqPos == (size_t)-1 && params.graph.nodeIDs[result.backward.trace.back().DPposition.node] == backwardNodeId && params.graph.nodeOffset[result.backward.trace.back().DPposition.node] + result.backward.trace.back().DPposition.nodeOffset == reversePos.second);
-			std::reverse(result.backward.trace.begin(), result.backward.trace.end());
 		}
-		if (!result.forward.failed())
+		void add(const TraceItem& cell)
 		{
-			assert(result.forward.trace.back().DPposition.seqPos == (size_t)-1 && params.graph.nodeIDs[result.forward.trace.back().DPposition.node] == forwardNodeId && params.graph.nodeOffset[result.forward.trace.back().DPposition.node] + result.forward.trace.back().DPposition.nodeOffset == seedHit.nodeOffset);
-			std::reverse(result.forward.trace.begin(), result.forward.trace.end());
+			if (anyFound)
+			{
+#ifndef NDEBUG
+				if (cell.DPposition.seqPos != (size_t)-1) aligner.verifyTraceStep(cell.DPposition, found, sequence);
+#endif
+				compact.addBefore(pending);
+			}
+			pending = aligner.fixForwardTraceCell(cell, start, sequence);
+			found = cell.DPposition;
+			anyFound = true;
 		}
-		return result;
-	}
-
-	void fixForwardTraceSeqPos(std::vector<TraceItem>& trace, LengthType start, const std::string& sequence) const
-	{
-		if (trace.size() == 0) return;
-		for (size_t i = 0; i < trace.size(); i++)
+		const MatrixPosition& lastFound() const
 		{
-			trace[i].DPposition.seqPos += start;
-			auto nodeIndex = trace[i].DPposition.node;
-			trace[i].DPposition.node = params.graph.nodeIDs[nodeIndex];
-			trace[i].DPposition.nodeOffset += params.graph.nodeOffset[nodeIndex];
-			assert(trace[i].DPposition.seqPos < sequence.size());
-			assert(i == 0 || trace[i].DPposition.seqPos == trace[0].DPposition.seqPos || trace[i].sequenceCharacter == sequence[trace[i].DPposition.seqPos]);
+			assert(anyFound);
+			return found;
 		}
-		trace[0].sequenceCharacter = sequence[trace[0].DPposition.seqPos];
-	}
+		OnewayTrace get()
+		{
+			assert(anyFound);
+			//the first cell is on the row before the aligned sequence
+			pending.sequenceCharacter = sequence[pending.DPposition.seqPos];
+			compact.addBefore(pending);
+			return compact.get();
+		}
+	private:
+		const GraphAligner& aligner;
+		const std::string& sequence;
+		LengthType start;
+		ReverseCompactTraceBuilder compact;
+		TraceItem pending;
+		MatrixPosition found;
+		bool anyFound;
+	};
 
-	void fixReverseTraceSeqPosAndOrder(std::vector<TraceItem>& trace, LengthType end, const std::string& sequence) const
+	//the backward direction is aligned reverse complemented, so its backtrace finds the cells in the read's order.
+	//a node switch belongs to the cell before it once the direction is turned, so a cell is compacted when the next one is found
+	class BackwardTraceCells
 	{
-		if (trace.size() == 0) return;
-		std::reverse(trace.begin(), trace.end());
-		for (size_t i = 0; i < trace.size(); i++)
+	public:
+		BackwardTraceCells(const GraphAligner& aligner, const std::string& sequence, LengthType end) :
+		aligner(aligner),
+		sequence(sequence),
+		end(end),
+		compact(),
+		pending(),
+		found(0, 0, 0),
+		anyFound(false)
+		{
+		}
+		void add(const TraceItem& cell)
 		{
-			assert(trace[i].DPposition.seqPos <= end || trace[i].DPposition.seqPos == (size_t)-1);
-			trace[i].DPposition.seqPos = end - trace[i].DPposition.seqPos;
-			size_t offset = params.graph.nodeOffset[trace[i].DPposition.node] + trace[i].DPposition.nodeOffset;
-			auto reversePos = params.graph.GetReversePosition(params.graph.nodeIDs[trace[i].DPposition.node], offset);
-			assert(reversePos.second < params.graph.originalNodeSize.at(params.graph.nodeIDs[trace[i].DPposition.node]));
-			trace[i].DPposition.node = reversePos.first;
-			trace[i].DPposition.nodeOffset = reversePos.second;
-			assert(trace[i].DPposition.seqPos < sequence.size());
-			trace[i].sequenceCharacter = sequence[trace[i].DPposition.seqPos];
-			trace[i].graphCharacter = CommonUtils::Complement(trace[i].graphCharacter);
+			if (anyFound)
+			{
+#ifndef NDEBUG
+				if (cell.DPposition.seqPos != (size_t)-1) aligner.verifyTraceStep(cell.DPposition, found, sequence);
+#endif
+				pending.nodeSwitch = cell.nodeSwitch;
+				compact.add(pending);
+			}
+			pending = aligner.fixReverseTraceCell(cell, end, sequence);
+			found = cell.DPposition;
+			anyFound = true;
 		}
-		for (size_t i = 0; i < trace.size() - 1; i++)
+		const MatrixPosition& lastFound() const
 		{
-			trace[i].nodeSwitch = trace[i+1].nodeSwitch;
+			assert(anyFound);
+			return found;
 		}
-		trace.back().nodeSwitch = false;
+		OnewayTrace get()
+		{
+			assert(anyFound);
+			pending.nodeSwitch = false;
+			compact.add(pending);
+			return compact.getOneway();
+		}
+	private:
+		const GraphAligner& aligner;
+		const std::string& sequence;
+		LengthType end;
+		CompactTraceBuilder compact;
+		TraceItem pending;
+		MatrixPosition found;
+		bool anyFound;
+	};
+
+	TraceItem fixForwardTraceCell(TraceItem cell, LengthType start, const std::string& sequence) const
+	{
+		cell.DPposition.seqPos += start;
+		auto nodeIndex = cell.DPposition.node;
+		cell.DPposition.node = params.graph.nodeIDs[nodeIndex];
+		cell.DPposition.nodeOffset += params.graph.nodeOffset[nodeIndex];
+		assert(cell.DPposition.seqPos < sequence.size());
+		assert(cell.DPposition.seqPos == start-1 || cell.sequenceCharacter == sequence[cell.DPposition.seqPos]);
+		return cell;
+	}
+
+	TraceItem fixReverseTraceCell(TraceItem cell, LengthType end, const std::string& sequence) const
+	{
+		assert(cell.DPposition.seqPos <= end || cell.DPposition.seqPos == (size_t)-1);
+		cell.DPposition.seqPos = end - cell.DPposition.seqPos;
+		size_t offset = params.graph.nodeOffset[cell.DPposition.node] + cell.DPposition.nodeOffset;
+		auto reversePos = params.graph.GetReversePosition(params.graph.nodeIDs[cell.DPposition.node], offset);
+		assert(reversePos.second < params.graph.originalNodeSize.at(params.graph.nodeIDs[cell.DPposition.node]));
+		cell.DPposition.node = reversePos.first;
+		cell.DPposition.nodeOffset = reversePos.second;
+		assert(cell.DPposition.seqPos < sequence.size());
+		cell.sequenceCharacter = sequence[cell.DPposition.seqPos];
+		cell.graphCharacter = CommonUtils::Complement(cell.graphCharacter);
+		return cell;
 	}
 
 	AlignmentResult::AlignmentItem getAlignmentFromSeed(const std::string& seq_id, const std::string& sequence, SeedHit seedHit, AlignerGraphsizedState& reusableState) const
@@ -235,52 +466,46 @@ private:
 		auto timeStart = std::chrono::system_clock::now();
 
 		auto trace = getTwoDirectionalTrace(sequence, seedHit, reusableState);
+		return alignmentFromTrace(sequence, std::move(trace), timeStart);
+	}
 
-#ifndef NDEBUG
-		if (trace.forward.trace.size() > 0) verifyTrace(trace.forward.trace, sequence, trace.forward.score);
-		if (trace.backward.trace.size() > 0) verifyTrace(trace.backward.trace, sequence, trace.backward.score);
-#endif
-		fixReverseTraceSeqPosAndOrder(trace.backward.trace, seedHit.seqPos-1, sequence);
-		fixForwardTraceSeqPos(trace.forward.trace, seedHit.seqPos+1, sequence);
-
+	AlignmentResult::AlignmentItem alignmentFromTrace(const std::string& sequence, Trace&& trace, std::chrono::time_point<std::chrono::system_clock> timeStart) const
+	{
 		//failed alignment, don't output
 		if (trace.forward.failed() && trace.backward.failed())
 		{
 			return emptyAlignment(0, 0);
 		}
 
-		// auto traceVector = getTraceInfo(sequence, trace.backward.trace, trace.forward.trace);
-
-		assert(trace.backward.trace.size() > 0 || trace.backward.failed());
-		auto mergedTrace = std::move(trace.backward);
-		if (mergedTrace.failed())
+		//the halves were compacted on their own and are joined at the seed cell which both of them have
+		CompactTraceBuilder compact;
+		if (trace.backward.failed())
 		{
-			mergedTrace = std::move(trace.forward);
+			compact.setScore(trace.forward.score);
+			compact.append(std::move(trace.forward));
 		}
-		else if (!mergedTrace.failed() && !trace.forward.failed())
+		else if (trace.forward.failed())
 		{
-			assert(mergedTrace.trace.size() > 0);
-			assert(mergedTrace.trace.back().DPposition == trace.forward.trace[0].DPposition);
-			mergedTrace.trace.pop_back();
-			mergedTrace.trace.insert(mergedTrace.trace.end(), trace.forward.trace.begin(), trace.forward.trace.end());
-			mergedTrace.score += trace.forward.score;
+			compact.setScore(trace.backward.score);
+			compact.append(std::move(trace.backward));
 		}
-		else if (!trace.forward.failed())
+		else
 		{
-			assert(trace.forward.trace.size() > 0);
-			mergedTrace.trace.insert(mergedTrace.trace.end(), trace.forward.trace.begin(), trace.forward.trace.end());
-			mergedTrace.score += trace.forward.score;
+			assert(trace.backward.numCells > 0);
+			assert(trace.backward.lastCells[1].DPposition == trace.forward.firstCells[0].DPposition);
+			compact.setScore(trace.backward.score + trace.forward.score);
+			compact.continueWithoutLastCell(std::move(trace.backward));
+			compact.append(std::move(trace.forward));
 		}
 
-		AlignmentResult::AlignmentItem result { std::move(mergedTrace), 0, std::numeric_limits<size_t>::max() };
+		AlignmentResult::AlignmentItem result { compact.get(), 0, std::numeric_limits<size_t>::max() };
 
 		LengthType seqstart = 0;
 		LengthType seqend = 0;
-		assert(result.trace->trace.size() > 0);
-		seqstart = result.trace->trace[0].DPposition.seqPos;
-		seqend = result.trace->trace.back().DPposition.seqPos;
+		assert(result.trace->runs.size() > 0);
+		seqstart = result.trace->runs[0].seqPos;
+		seqend = result.trace->runs.back().lastSeqPos();
 		assert(seqend < sequence.size());
-		// result.trace = traceVector;
 		result.alignmentStart = seqstart;
 		result.alignmentEnd = seqend + 1;
 		auto timeEnd = std::chrono::system_clock::now();
@@ -298,34 +523,24 @@ private:
 	}
 
 #ifndef NDEBUG
-	void verifyTrace(const std::vector<TraceItem>& trace, const std::string& sequence, ScoreType score) const
+	//checks a step of a trace from the cell at oldpos to the cell at newpos after it in the read.
+	//the steps on the row before the aligned sequence aren't checked
+	void verifyTraceStep(MatrixPosition oldpos, MatrixPosition newpos, const std::string& sequence) const
 	{
-		size_t start = 0;
-		while (trace[start].DPposition.seqPos == (size_t)-1)
-		{
-			start++;
-			assert(start < trace.size());
-		}
-		start++;
-		for (size_t i = start; i < trace.size(); i++)
+		assert(newpos.seqPos < sequence.size());
+		auto oldNodeIndex = oldpos.node;
+		auto newNodeIndex = newpos.node;
+		assert(newpos.seqPos != oldpos.seqPos || newpos.node != oldpos.node || newpos.nodeOffset != oldpos.nodeOffset);
+		if (oldNodeIndex == newNodeIndex)
 		{
-			assert(trace[i].DPposition.seqPos < sequence.size());
-			auto newpos = trace[i].DPposition;
-			auto oldpos = trace[i-1].DPposition;
-			auto oldNodeIndex = oldpos.node;
-			auto newNodeIndex = newpos.node;
-			assert(newpos.seqPos != oldpos.seqPos || newpos.node != oldpos.node || newpos.nodeOffset != oldpos.nodeOffset);
-			if (oldNodeIndex == newNodeIndex)
-			{
-				assert((newpos.nodeOffset >= oldpos.nodeOffset && newpos.seqPos >= oldpos.seqPos) || (oldpos.nodeOffset == params.graph.NodeLength(newNodeIndex)-1 && newpos.nodeOffset == 0 && (newpos.seqPos == oldpos.seqPos || newpos.seqPos == oldpos.seqPos+1)));
-				continue;
-			}
-			assert(oldNodeIndex != newNodeIndex);
-			assert(std::find(params.graph.outNeighbors[oldpos.node].begin(), params.graph.outNeighbors[oldpos.node].end(), newpos.node) != params.graph.outNeighbors[oldpos.node].end());
-			assert(newpos.seqPos == oldpos.seqPos || newpos.seqPos == oldpos.seqPos+1);
-			assert(oldpos.nodeOffset == params.graph.NodeLength(oldNodeIndex)-1);
-			assert(newpos.nodeOffset == 0);
+			assert((newpos.nodeOffset >= oldpos.nodeOffset && newpos.seqPos >= oldpos.seqPos) || (oldpos.nodeOffset == params.graph.NodeLength(newNodeIndex)-1 && newpos.nodeOffset == 0 && (newpos.seqPos == oldpos.seqPos || newpos.seqPos == oldpos.seqPos+1)));
+			return;
 		}
+		assert(oldNodeIndex != newNodeIndex);
+		assert(std::find(params.graph.outNeighbors[oldpos.node].begin(), params.graph.outNeighbors[oldpos.node].end(), newpos.node) != params.graph.outNeighbors[oldpos.node].end());
+		assert(newpos.seqPos == oldpos.seqPos || newpos.seqPos == oldpos.seqPos+1);
+		assert(oldpos.nodeOffset == params.graph.NodeLength(oldNodeIndex)-1);
+		assert(newpos.nodeOffset == 0);
 	}
 #endif
 
@@ -30,8 +30,7 @@ private:
 	using AlignerGraphsizedState = typename Common::AlignerGraphsizedState;
 	using Params = typename Common::Params;
 	using MatrixPosition = typename Common::MatrixPosition;
-	using Trace = typename Common::Trace;
-	using OnewayTrace = typename Common::OnewayTrace;
+	using TraceItem = typename Common::TraceItem;
 	using WordSlice = typename BV::WordSlice;
 	using EqVector = typename BV::EqVector;
 	using EdgeWithPriority = typename Common::EdgeWithPriority;
@@ -121,6 +120,39 @@ private:
 		{}
 		std::vector<DPSlice> slices;
 	};
+	//hands the cells to the sink as the backtrace finds them instead of collecting the whole trace.
+	//only the cells on the current row are kept to check that the backtrace doesn't go around in a cycle
+	template <typename CellSink>
+	class BacktraceCells
+	{
+	public:
+		BacktraceCells(CellSink& sink) :
+		sink(sink),
+		row()
+		{
+		}
+		void emplace_back(MatrixPosition pos, bool nodeSwitch, const std::string& sequence, const AlignmentGraph& graph)
+		{
+			if (row.size() > 0 && row.back().DPposition.seqPos != pos.seqPos) row.clear();
+			row.emplace_back(pos, nodeSwitch, sequence, graph);
+			sink.add(row.back());
+		}
+		const TraceItem& back() const
+		{
+			return row.back();
+		}
+		void checkCircularity() const
+		{
+			for (size_t i = row.size()-2; i < row.size(); i--)
+			{
+				assert(row[i].DPposition != row.back().DPposition);
+				if (row[i].DPposition == row.back().DPposition) std::abort();
+			}
+		}
+	private:
+		CellSink& sink;
+		std::vector<TraceItem> row;
+	};
 public:
 
 	GraphAlignerBitvectorBanded(const Params& params) :
@@ -128,7 +160,10 @@ public:
 	{
 	}
 
-	OnewayTrace getReverseTraceFromSeed(const std::string& sequence, int bigraphNodeId, size_t nodeOffset, bool forceGlobal, AlignerGraphsizedState& reusableState) const
+	//the backtrace gives the cells to cells.add() from the end of the alignment back to the seed.
+	//returns the score of the alignment, or the max score if it failed
+	template <typename CellSink>
+	ScoreType getReverseTraceFromSeed(const std::string& sequence, int bigraphNodeId, size_t nodeOffset, bool forceGlobal, AlignerGraphsizedState& reusableState, CellSink& cells) const
 	{
 		size_t numSlices = (sequence.size() + WordConfiguration<Word>::WordSize - 1) / WordConfiguration<Word>::WordSize;
 		auto initialBandwidth = getInitialSliceExactPosition(bigraphNodeId, nodeOffset);
@@ -136,26 +171,29 @@ public:
 		if (!params.preciseClipping && !forceGlobal) removeWronglyAlignedEnd(slice);
 		if (slice.slices.size() <= 1)
 		{
-			return OnewayTrace::TraceFailed();
+			return std::numeric_limits<ScoreType>::max();
 		}
 		assert(sequence.size() <= std::numeric_limits<ScoreType>::max() - WordConfiguration<Word>::WordSize * 2);
 		assert(slice.slices.back().minScore >= 0);
 		assert(slice.slices.back().minScore <= (ScoreType)sequence.size() + (ScoreType)WordConfiguration<Word>::WordSize * 2);
 
-		OnewayTrace result;
+		ScoreType result;
 		if (params.preciseClipping)
 		{
-			result = getReverseTraceFromTableExactEndPos(sequence, slice, reusableState);
+			result = getReverseTraceFromTableExactEndPos(sequence, slice, reusableState, cells);
 		}
 		else
 		{
-			result = getReverseTraceFromTableStartLastRow(sequence, slice, reusableState);
+			result = getReverseTraceFromTableStartLastRow(sequence, slice, reusableState, cells);
 		}
 
 		return result;
 	}
 
-	OnewayTrace getBacktraceFullStart(std::string originalSequence, bool forceGlobal, AlignerGraphsizedState& reusableState) const
+	//same as getReverseTraceFromSeed except the seq positions of the cells are in the sequence without its first character.
+	//the cells on the row before it are aligned to the first character
+	template <typename CellSink>
+	ScoreType getBacktraceFullStart(std::string originalSequence, bool forceGlobal, AlignerGraphsizedState& reusableState, CellSink& cells) const
 	{
 		assert(originalSequence.size() > 1);
 		DPSlice startSlice;
@@ -198,31 +236,25 @@ public:
 		if (!params.preciseClipping && !forceGlobal) removeWronglyAlignedEnd(slice);
 		if (slice.slices.size() <= 1)
 		{
-			return OnewayTrace::TraceFailed();
+			return std::numeric_limits<ScoreType>::max();
 		}
 
-		OnewayTrace result;
+		ScoreType result;
 		if (params.preciseClipping)
 		{
-			result = getReverseTraceFromTableExactEndPos(alignableSequence, slice, reusableState);
+			result = getReverseTraceFromTableExactEndPos(alignableSequence, slice, reusableState, cells);
 		}
 		else
 		{
-			result = getReverseTraceFromTableStartLastRow(alignableSequence, slice, reusableState);
+			result = getReverseTraceFromTableStartLastRow(alignableSequence, slice, reusableState, cells);
 		}
-		for (size_t i = 0; i < result.trace.size(); i++)
-		{
-			result.trace[i].DPposition.seqPos += 1;
-		}
-		std::reverse(result.trace.begin(), result.trace.end());
-		result.trace[0].sequenceCharacter = originalSequence[0];
-		assert(result.trace[0].DPposition.seqPos == 0);
 		return result;
 	}
 
 private:
 
-	OnewayTrace getReverseTraceFromTableExactEndPos(const std::string& sequence, const DPTable& slice, AlignerGraphsizedState& reusableState) const
+	template <typename CellSink>
+	ScoreType getReverseTraceFromTableExactEndPos(const std::string& sequence, const DPTable& slice, AlignerGraphsizedState& reusableState, CellSink& cells) const
 	{
 		assert(slice.slices.size() > 1);
 		size_t bestIndex = 1;
@@ -280,34 +312,35 @@ private:
 		assert(slice.slices[bestIndex].j + bvOffset < sequence.size());
 		ScoreType startScore = nodeSlices[nodeOffset].getValue(bvOffset);
 		MatrixPosition startPos { node, nodeOffset, slice.slices[bestIndex].j + bvOffset };
-		return getReverseTraceFromTable(sequence, slice, reusableState, startPos, startScore);
+		return getReverseTraceFromTable(sequence, slice, reusableState, startPos, startScore, cells);
 	}
 
-	OnewayTrace getReverseTraceFromTableStartLastRow(const std::string& sequence, const DPTable& slice, AlignerGraphsizedState& reusableState) const
+	template <typename CellSink>
+	ScoreType getReverseTraceFromTableStartLastRow(const std::string& sequence, const DPTable& slice, AlignerGraphsizedState& reusableState, CellSink& cells) const
 	{
 		ScoreType startScore = slice.slices.back().minScore;
 		MatrixPosition startPos {slice.slices.back().minScoreNode, slice.slices.back().minScoreNodeOffset, std::min(slice.slices.back().j + WordConfiguration<Word>::WordSize - 1, sequence.size()-1)};
-		return getReverseTraceFromTable(sequence, slice, reusableState, startPos, startScore);
+		return getReverseTraceFromTable(sequence, slice, reusableState, startPos, startScore, cells);
 	}
 
-	OnewayTrace getReverseTraceFromTable(const std::string& sequence, const DPTable& slice, AlignerGraphsizedState& reusableState, MatrixPosition startPos, ScoreType startScore) const
+	template <typename CellSink>
+	ScoreType getReverseTraceFromTable(const std::string& sequence, const DPTable& slice, AlignerGraphsizedState& reusableState, MatrixPosition startPos, ScoreType startScore, CellSink& cells) const
 	{
 		assert(slice.slices.size() > 0);
 		assert(slice.slices.back().minScoreNode != std::numeric_limits<LengthType>::max());
 		assert(slice.slices.back().minScoreNodeOffset != std::numeric_limits<LengthType>::max());
-		OnewayTrace result;
-		result.score = startScore;
-		result.trace.emplace_back(startPos, false, sequence, params.graph);
+		BacktraceCells<CellSink> trace { cells };
+		trace.emplace_back(startPos, false, sequence, params.graph);
 		LengthType currentNode = std::numeric_limits<LengthType>::max();
 		size_t currentSlice = slice.slices.size();
 		std::vector<WordSlice> nodeSlices;
-		while (result.trace.back().DPposition.seqPos != (size_t)-1)
+		while (trace.back().DPposition.seqPos != (size_t)-1)
 		{
-			size_t newSlice = result.trace.back().DPposition.seqPos / WordConfiguration<Word>::WordSize + 1;
+			size_t newSlice = trace.back().DPposition.seqPos / WordConfiguration<Word>::WordSize + 1;
 			assert(newSlice < slice.slices.size());
-			assert(result.trace.back().DPposition.seqPos >= slice.slices[newSlice].j);
-			assert(result.trace.back().DPposition.seqPos < slice.slices[newSlice].j + WordConfiguration<Word>::WordSize);
-			LengthType newNode = result.trace.back().DPposition.node;
+			assert(trace.back().DPposition.seqPos >= slice.slices[newSlice].j);
+			assert(trace.back().DPposition.seqPos < slice.slices[newSlice].j + WordConfiguration<Word>::WordSize);
+			LengthType newNode = trace.back().DPposition.node;
 			if (newSlice != currentSlice || newNode != currentNode)
 			{
 				currentSlice = newSlice;
@@ -332,85 +365,85 @@ private:
 				std::cerr << "j " << slice.slices[currentSlice].j << " firstbt-calc " << slice.slices[currentSlice].scores.node(currentNode).firstSlicesCalcedWhenCalced << " lastbt-calc " << slice.slices[currentSlice].scores.node(currentNode).slicesCalcedWhenCalced << std::endl;
 #endif
 			}
-			assert(result.trace.back().DPposition.node == currentNode);
-			assert(result.trace.back().DPposition.nodeOffset < params.graph.NodeLength(currentNode));
+			assert(trace.back().DPposition.node == currentNode);
+			assert(trace.back().DPposition.nodeOffset < params.graph.NodeLength(currentNode));
 			assert(nodeSlices.size() == params.graph.NodeLength(currentNode));
-			assert(result.trace.back().DPposition.seqPos >= slice.slices[currentSlice].j);
-			assert(result.trace.back().DPposition.seqPos < slice.slices[currentSlice].j + WordConfiguration<Word>::WordSize);
+			assert(trace.back().DPposition.seqPos >= slice.slices[currentSlice].j);
+			assert(trace.back().DPposition.seqPos < slice.slices[currentSlice].j + WordConfiguration<Word>::WordSize);
 			assert((ScoreType)slice.slices[currentSlice].bandwidth >= 0);
 			assert((ScoreType)slice.slices[currentSlice].bandwidth < std::numeric_limits<ScoreType>::max());
 			assert(slice.slices[currentSlice].minScore < std::numeric_limits<ScoreType>::max() - (ScoreType)slice.slices[currentSlice].bandwidth);
-			if (result.trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize == 0 && result.trace.back().DPposition.nodeOffset == 0)
+			if (trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize == 0 && trace.back().DPposition.nodeOffset == 0)
 			{
 				auto bt = pickBacktraceCorner(slice.slices[currentSlice].scores, slice.slices[currentSlice-1].scores, currentNode, slice.slices[currentSlice].j, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid);
-				result.trace.emplace_back(bt.first, bt.second, sequence, params.graph);
-				checkBacktraceCircularity(result);
+				trace.emplace_back(bt.first, bt.second, sequence, params.graph);
+				trace.checkCircularity();
 				continue;
 			}
-			if (result.trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize == 0)
+			if (trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize == 0)
 			{
 				assert(currentSlice > 0);
-				assert(result.trace.back().DPposition.nodeOffset > 0);
+				assert(trace.back().DPposition.nodeOffset > 0);
 				if (!slice.slices[currentSlice-1].scores.hasNode(currentNode))
 				{
-					result.trace.emplace_back(MatrixPosition {currentNode, 0, result.trace.back().DPposition.seqPos}, false, sequence, params.graph);
+					trace.emplace_back(MatrixPosition {currentNode, 0, trace.back().DPposition.seqPos}, false, sequence, params.graph);
 					continue;
 				}
-				auto crossing = pickBacktraceVerticalCrossing(slice.slices[currentSlice].scores, slice.slices[currentSlice-1].scores, nodeSlices, slice.slices[currentSlice].j, currentNode, result.trace.back().DPposition, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid);
-				assert(crossing.first.first.node == result.trace.back().DPposition.node);
-				assert(crossing.first.first.seqPos == result.trace.back().DPposition.seqPos);
-				assert(crossing.first.first.nodeOffset <= result.trace.back().DPposition.nodeOffset);
+				auto crossing = pickBacktraceVerticalCrossing(slice.slices[currentSlice].scores, slice.slices[currentSlice-1].scores, nodeSlices, slice.slices[currentSlice].j, currentNode, trace.back().DPposition, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid);
+				assert(crossing.first.first.node == trace.back().DPposition.node);
+				assert(crossing.first.first.seqPos == trace.back().DPposition.seqPos);
+				assert(crossing.first.first.nodeOffset <= trace.back().DPposition.nodeOffset);
 				assert(!crossing.first.second);
-				if (crossing.first.first.nodeOffset != result.trace.back().DPposition.nodeOffset)
+				if (crossing.first.first.nodeOffset != trace.back().DPposition.nodeOffset)
 				{
-					for (size_t nodeOffset = result.trace.back().DPposition.nodeOffset-1; nodeOffset != crossing.first.first.nodeOffset; nodeOffset--)
+					for (size_t nodeOffset = trace.back().DPposition.nodeOffset-1; nodeOffset != crossing.first.first.nodeOffset; nodeOffset--)
 					{
-						result.trace.emplace_back(MatrixPosition { crossing.first.first.node, nodeOffset, crossing.first.first.seqPos }, false, sequence, params.graph);
+						trace.emplace_back(MatrixPosition { crossing.first.first.node, nodeOffset, crossing.first.first.seqPos }, false, sequence, params.graph);
 					}
 				}
-				if (crossing.first.first != result.trace.back().DPposition) result.trace.emplace_back(crossing.first.first, crossing.first.second, sequence, params.graph);
-				assert(crossing.first.first == result.trace.back().DPposition);
-				assert(crossing.second.first != result.trace.back().DPposition);
-				result.trace.emplace_back(crossing.second.first, crossing.second.second, sequence, params.graph);
+				if (crossing.first.first != trace.back().DPposition) trace.emplace_back(crossing.first.first, crossing.first.second, sequence, params.graph);
+				assert(crossing.first.first == trace.back().DPposition);
+				assert(crossing.second.first != trace.back().DPposition);
+				trace.emplace_back(crossing.second.first, crossing.second.second, sequence, params.graph);
 				continue;
 			}
-			if (result.trace.back().DPposition.nodeOffset == 0)
+			if (trace.back().DPposition.nodeOffset == 0)
 			{
-				assert(result.trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize != 0);
-				auto crossing = pickBacktraceHorizontalCrossing(slice.slices[currentSlice].scores, slice.slices[currentSlice-1].scores, slice.slices[currentSlice].j, currentNode, result.trace.back().DPposition, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid);
-				assert(crossing.first.first.node == result.trace.back().DPposition.node);
-				assert(crossing.first.first.nodeOffset == result.trace.back().DPposition.nodeOffset);
-				assert(crossing.first.first.seqPos <= result.trace.back().DPposition.seqPos);
+				assert(trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize != 0);
+				auto crossing = pickBacktraceHorizontalCrossing(slice.slices[currentSlice].scores, slice.slices[currentSlice-1].scores, slice.slices[currentSlice].j, currentNode, trace.back().DPposition, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid);
+				assert(crossing.first.first.node == trace.back().DPposition.node);
+				assert(crossing.first.first.nodeOffset == trace.back().DPposition.nodeOffset);
+				assert(crossing.first.first.seqPos <= trace.back().DPposition.seqPos);
 				assert(!crossing.first.second);
-				if (crossing.first.first.seqPos != result.trace.back().DPposition.seqPos)
+				if (crossing.first.first.seqPos != trace.back().DPposition.seqPos)
 				{
-					for (size_t seqPos = result.trace.back().DPposition.seqPos-1; seqPos != crossing.first.first.seqPos; seqPos--)
+					for (size_t seqPos = trace.back().DPposition.seqPos-1; seqPos != crossing.first.first.seqPos; seqPos--)
 					{
-						result.trace.emplace_back(MatrixPosition { crossing.first.first.node, crossing.first.first.nodeOffset, seqPos }, false, sequence, params.graph);
+						trace.emplace_back(MatrixPosition { crossing.first.first.node, crossing.first.first.nodeOffset, seqPos }, false, sequence, params.graph);
 					}
 				}
-				if (crossing.first.first != result.trace.back().DPposition) result.trace.emplace_back(crossing.first.first, crossing.first.second, sequence, params.graph);
-				assert(crossing.first.first == result.trace.back().DPposition);
-				assert(crossing.second.first != result.trace.back().DPposition);
-				result.trace.emplace_back(crossing.second.first, crossing.second.second, sequence, params.graph);
-				checkBacktraceCircularity(result);
+				if (crossing.first.first != trace.back().DPposition) trace.emplace_back(crossing.first.first, crossing.first.second, sequence, params.graph);
+				assert(crossing.first.first == trace.back().DPposition);
+				assert(crossing.second.first != trace.back().DPposition);
+				trace.emplace_back(crossing.second.first, crossing.second.second, sequence, params.graph);
+				trace.checkCircularity();
 				continue;
 			}
-			assert(result.trace.back().DPposition.nodeOffset != 0);
-			assert(result.trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize != 0);
-			auto inner = pickBacktraceInside(slice.slices[currentSlice].j, nodeSlices, result.trace.back().DPposition, sequence);
+			assert(trace.back().DPposition.nodeOffset != 0);
+			assert(trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize != 0);
+			auto inner = pickBacktraceInside(slice.slices[currentSlice].j, nodeSlices, trace.back().DPposition, sequence);
 			for (auto pos : inner)
 			{
-				result.trace.emplace_back(pos, false, sequence, params.graph);
+				trace.emplace_back(pos, false, sequence, params.graph);
 			}
 		}
 		do
 		{
-			assert(result.trace.back().DPposition.seqPos == (size_t)-1);
-			assert(slice.slices[0].scores.hasNode(result.trace.back().DPposition.node));
-			auto node = slice.slices[0].scores.node(result.trace.back().DPposition.node);
+			assert(trace.back().DPposition.seqPos == (size_t)-1);
+			assert(slice.slices[0].scores.hasNode(trace.back().DPposition.node));
+			auto node = slice.slices[0].scores.node(trace.back().DPposition.node);
 			std::vector<ScoreType> beforeSliceScores;
-			beforeSliceScores.resize(params.graph.NodeLength(result.trace.back().DPposition.node));
+			beforeSliceScores.resize(params.graph.NodeLength(trace.back().DPposition.node));
 			beforeSliceScores[0] = node.startSlice.scoreEnd;
 			for (size_t i = 1; i < beforeSliceScores.size(); i++)
 			{
@@ -420,18 +453,18 @@ private:
 				beforeSliceScores[i] = beforeSliceScores[i-1] + ((node.HP[chunk] & mask) >> offset) - ((node.HN[chunk] & mask) >> offset);
 			}
 			assert(beforeSliceScores.back() == node.endSlice.scoreEnd);
-			while (beforeSliceScores[result.trace.back().DPposition.nodeOffset] != 0 && result.trace.back().DPposition.nodeOffset > 0 && beforeSliceScores[result.trace.back().DPposition.nodeOffset-1] == beforeSliceScores[result.trace.back().DPposition.nodeOffset] - 1)
+			while (beforeSliceScores[trace.back().DPposition.nodeOffset] != 0 && trace.back().DPposition.nodeOffset > 0 && beforeSliceScores[trace.back().DPposition.nodeOffset-1] == beforeSliceScores[trace.back().DPposition.nodeOffset] - 1)
 			{
-				result.trace.emplace_back(MatrixPosition {result.trace.back().DPposition.node, result.trace.back().DPposition.nodeOffset-1, result.trace.back().DPposition.seqPos}, false, sequence, params.graph);
+				trace.emplace_back(MatrixPosition {trace.back().DPposition.node, trace.back().DPposition.nodeOffset-1, trace.back().DPposition.seqPos}, false, sequence, params.graph);
 			}
-			if (result.trace.back().DPposition.nodeOffset == 0 && beforeSliceScores[result.trace.back().DPposition.nodeOffset] != 0)
+			if (trace.back().DPposition.nodeOffset == 0 && beforeSliceScores[trace.back().DPposition.nodeOffset] != 0)
 			{
 				bool found = false;
-				for (auto neighbor : params.graph.inNeighbors[result.trace.back().DPposition.node])
+				for (auto neighbor : params.graph.inNeighbors[trace.back().DPposition.node])
 				{
-					if (slice.slices[0].scores.hasNode(neighbor) && slice.slices[0].scores.node(neighbor).endSlice.getScoreBeforeStart() == beforeSliceScores[result.trace.back().DPposition.nodeOffset] - 1)
+					if (slice.slices[0].scores.hasNode(neighbor) && slice.slices[0].scores.node(neighbor).endSlice.getScoreBeforeStart() == beforeSliceScores[trace.back().DPposition.nodeOffset] - 1)
 					{
-						result.trace.emplace_back(MatrixPosition {neighbor, params.graph.NodeLength(neighbor)-1, result.trace.back().DPposition.seqPos}, true, sequence, params.graph);
+						trace.emplace_back(MatrixPosition {neighbor, params.graph.NodeLength(neighbor)-1, trace.back().DPposition.seqPos}, true, sequence, params.graph);
 						found = true;
 						break;
 					}
@@ -439,17 +472,7 @@ private:
 				if (found) continue;
 			}
 		} while (false);
-		return result;
-	}
-
-	void checkBacktraceCircularity(const OnewayTrace& result) const
-	{
-		for (size_t i = result.trace.size()-2; i < result.trace.size(); i--)
-		{
-			assert(result.trace[i].DPposition != result.trace.back().DPposition);
-			if (result.trace[i].DPposition == result.trace.back().DPposition) std::abort();
-			if (result.trace[i].DPposition.seqPos != result.trace.back().DPposition.seqPos) return;
-		}
+		return startScore;
 	}
 
 	std::vector<MatrixPosition> pickBacktraceInside(LengthType verticalOffset, const std::vector<WordSlice>& nodeSlices, MatrixPosition pos, const std::string& sequence) const
@@ -2,6 +2,7 @@
 #define GraphAlignerCommon_h
 
 #include <vector>
+#include <algorithm>
 #include "AlignmentGraph.h"
 #include "ArrayPriorityQueue.h"
 #include "ComponentPriorityQueue.h"
@@ -123,7 +124,7 @@ public:
 	struct TraceItem
 	{
 		TraceItem() :
-		DPposition(),
+		DPposition(0, 0, 0),
 		nodeSwitch(false),
 		sequenceCharacter('-'),
 		graphCharacter('-')
@@ -145,11 +146,59 @@ public:
 		char sequenceCharacter;
 		char graphCharacter;
 	};
+	//a finished trace stored as runs of cells with the same edit on the same node instead of an item per DP cell.
+	//positions are in the original graph's nodes and in the read
+	class CompactTrace
+	{
+	public:
+		enum RunType : unsigned char
+		{
+			Match,
+			Mismatch,
+			Insertion,
+			Deletion
+		};
+		//the cells of a run step forward in the read and / or the node depending on the type
+		struct Run
+		{
+			size_t node;
+			size_t nodeOffset;
+			size_t seqPos;
+			uint32_t length;
+			RunType type;
+			//the first cell starts a new node in the path
+			bool newNode;
+			size_t lastNodeOffset() const
+			{
+				return type == Insertion ? nodeOffset : nodeOffset + length - 1;
+			}
+			size_t lastSeqPos() const
+			{
+				return type == Deletion ? seqPos : seqPos + length - 1;
+			}
+		};
+		CompactTrace() :
+		runs(),
+		score(0)
+		{
+		}
+		CompactTrace(const CompactTrace& other) = delete;
+		CompactTrace(CompactTrace&& other) = default;
+		CompactTrace& operator=(const CompactTrace& other) = delete;
+		CompactTrace& operator=(CompactTrace&& other) = default;
+		std::vector<Run> runs;
+		ScoreType score;
+	};
+	//one direction of a seed extension, or a full start alignment, compacted into runs while the backtrace finds its cells.
+	//the cells at both ends are kept so that the two directions can be joined at the seed
 	class OnewayTrace
 	{
 	public:
 		OnewayTrace() :
-		trace(),
+		runs(),
+		numCells(0),
+		firstCells(),
+		lastCells(),
 		score(0)
 		{
 		}
@@ -168,7 +217,11 @@ public:
 		{
 			return score == std::numeric_limits<ScoreType>::max();
 		}
-		std::vector<TraceItem> trace;
+		std::vector<typename CompactTrace::Run> runs;
+		size_t numCells;
+		//the first two and the last two cells in the read's order
+		TraceItem firstCells[2];
+		TraceItem lastCells[2];
 		ScoreType score;
 	};
 	class Trace
@@ -177,6 +230,204 @@ public:
 		OnewayTrace forward;
 		OnewayTrace backward;
 	};
+	//compacts the cells of a trace given in the read's order
+	class CompactTraceBuilder
+	{
+	public:
+		CompactTraceBuilder() :
+		result(),
+		score(0)
+		{
+		}
+		void add(const TraceItem& cell)
+		{
+			if (result.numCells == 0)
+			{
+				startRun(result.runs, cell, firstCellType(cell), true);
+				result.firstCells[0] = cell;
+			}
+			else
+			{
+				const TraceItem& previous = result.lastCells[1];
+				bool insideNode = continuesNode(previous, cell);
+				auto type = cellType(previous, cell, insideNode);
+				auto& last = result.runs.back();
+				if (continuesRun(previous, last.type, cell, type, insideNode))
+				{
+					assert(last.length < std::numeric_limits<uint32_t>::max());
+					last.length += 1;
+				}
+				else
+				{
+					startRun(result.runs, cell, type, !insideNode);
+				}
+				if (result.numCells == 1) result.firstCells[1] = cell;
+			}
+			result.lastCells[0] = result.lastCells[1];
+			result.lastCells[1] = cell;
+			result.numCells += 1;
+		}
+		//continues from a trace without its last cell, so the cell can be replaced by the first cell of another trace
+		void continueWithoutLastCell(OnewayTrace&& trace)
+		{
+			assert(result.numCells == 0);
+			assert(trace.numCells > 0);
+			result = std::move(trace);
+			result.runs.back().length -= 1;
+			if (result.runs.back().length == 0) result.runs.pop_back();
+			result.numCells -= 1;
+			result.lastCells[1] = result.lastCells[0];
+		}
+		//adds the cells of a trace which was compacted on its own. only its first two cells can compact differently
+		//after the cells added so far, so they are added again and the rest of its runs are copied
+		void append(OnewayTrace&& trace)
+		{
+			assert(trace.numCells > 0);
+			if (result.numCells == 0)
+			{
+				result = std::move(trace);
+				return;
+			}
+			size_t readded = std::min<size_t>(trace.numCells, 2);
+			for (size_t i = 0; i < readded; i++) add(trace.firstCells[i]);
+			if (trace.numCells == readded) return;
+			size_t skipped = 0;
+			size_t run = 0;
+			while (skipped + trace.runs[run].length <= readded)
+			{
+				skipped += trace.runs[run].length;
+				run++;
+			}
+			if (skipped < readded)
+			{
+				//the third cell continues the run of the second
+				result.runs.back().length += trace.runs[run].length - (readded - skipped);
+				run++;
+			}
+			result.runs.insert(result.runs.end(), trace.runs.begin() + run, trace.runs.end());
+			result.numCells += trace.numCells - readded;
+			result.lastCells[0] = trace.lastCells[0];
+			result.lastCells[1] = trace.lastCells[1];
+		}
+		void setScore(ScoreType score)
+		{
+			this->score = score;
+		}
+		CompactTrace get()
+		{
+			CompactTrace compact;
+			compact.runs = std::move(result.runs);
+			compact.score = score;
+			return compact;
+		}
+		//the cells added so far as one direction of a trace, without a score
+		OnewayTrace getOneway()
+		{
+			return std::move(result);
+		}
+	private:
+		OnewayTrace result;
+		ScoreType score;
+	};
+	//compacts the cells of a trace given from the end of the read towards the start, in the order the backtrace finds them.
+	//a run is decided once the cell before it is known so the result is the same as compacting the cells in the read's order
+	class ReverseCompactTraceBuilder
+	{
+	public:
+		ReverseCompactTraceBuilder() :
+		result(),
+		nextType(CompactTrace::Match),
+		nextInsideNode(false)
+		{
+		}
+		//adds a cell before the cells added so far
+		void addBefore(const TraceItem& cell)
+		{
+			if (result.numCells == 0)
+			{
+				result.lastCells[1] = cell;
+			}
+			else
+			{
+				const TraceItem& next = result.firstCells[0];
+				bool insideNode = continuesNode(cell, next);
+				addFirstCellRun(cellType(cell, next, insideNode), insideNode);
+				if (result.numCells == 1) result.lastCells[0] = cell;
+			}
+			result.firstCells[1] = result.firstCells[0];
+			result.firstCells[0] = cell;
+			result.numCells += 1;
+		}
+		OnewayTrace get()
+		{
+			if (result.numCells > 0)
+			{
+				addFirstCellRun(firstCellType(result.firstCells[0]), false);
+				result.runs.back().newNode = true;
+			}
+			std::reverse(result.runs.begin(), result.runs.end());
+			return std::move(result);
+		}
+	private:
+		//the type of the first cell is known once the cell before it is, so it either joins the run of the cell after it or starts a new one
+		void addFirstCellRun(typename CompactTrace::RunType type, bool insideNode)
+		{
+			const TraceItem& cell = result.firstCells[0];
+			if (result.numCells >= 2 && continuesRun(cell, type, result.firstCells[1], nextType, nextInsideNode))
+			{
+				auto& run = result.runs.back();
+				assert(run.length < std::numeric_limits<uint32_t>::max());
+				run.node = cell.DPposition.node;
+				run.nodeOffset = cell.DPposition.nodeOffset;
+				run.seqPos = cell.DPposition.seqPos;
+				run.length += 1;
+			}
+			else
+			{
+				if (result.numCells >= 2) result.runs.back().newNode = !nextInsideNode;
+				startRun(result.runs, cell, type, false);
+			}
+			nextType = type;
+			nextInsideNode = insideNode;
+		}
+		OnewayTrace result;
+		typename CompactTrace::RunType nextType;
+		bool nextInsideNode;
+	};
+	//the compaction rules only look at a cell and the cell before it.
+	//a node switch to the next offset of the same node crosses a split node boundary, not a new node in the path
+	static bool continuesNode(const TraceItem& previous, const TraceItem& cell)
+	{
+		return !previous.nodeSwitch || (cell.DPposition.node == previous.DPposition.node && cell.DPposition.nodeOffset == previous.DPposition.nodeOffset + 1);
+	}
+	static typename CompactTrace::RunType firstCellType(const TraceItem& cell)
+	{
+		return characterMatch(cell.sequenceCharacter, cell.graphCharacter) ? CompactTrace::Match : CompactTrace::Mismatch;
+	}
+	static typename CompactTrace::RunType cellType(const TraceItem& previous, const TraceItem& cell, bool insideNode)
+	{
+		if (previous.DPposition.seqPos == cell.DPposition.seqPos) return CompactTrace::Deletion;
+		if (insideNode && previous.DPposition.nodeOffset == cell.DPposition.nodeOffset) return CompactTrace::Insertion;
+		return firstCellType(cell);
+	}
+	//a cell which doesn't step exactly one cell from the previous one starts a new run so every cell's position can be recovered
+	static bool continuesRun(const TraceItem& previous, typename CompactTrace::RunType previousType, const TraceItem& cell, typename CompactTrace::RunType type, bool insideNode)
+	{
+		if (!insideNode || type != previousType || cell.DPposition.node != previous.DPposition.node) return false;
+		size_t seqStep = (type == CompactTrace::Deletion) ? 0 : 1;
+		size_t nodeStep = (type == CompactTrace::Insertion) ? 0 : 1;
+		return cell.DPposition.seqPos == previous.DPposition.seqPos + seqStep && cell.DPposition.nodeOffset == previous.DPposition.nodeOffset + nodeStep;
+	}
+	static void startRun(std::vector<typename CompactTrace::Run>& runs, const TraceItem& cell, typename CompactTrace::RunType type, bool newNode)
+	{
+		runs.emplace_back();
+		runs.back().node = cell.DPposition.node;
+		runs.back().nodeOffset = cell.DPposition.nodeOffset;
+		runs.back().seqPos = cell.DPposition.seqPos;
+		runs.back().length = 1;
+		runs.back().type = type;
+		runs.back().newNode = newNode;
+	}
 #ifdef NDEBUG
 	__attribute__((always_inline))
 #endif
@@ -285,7 +536,7 @@ public:
 		alignmentStart(0),
 		alignmentEnd(0)
 		{}
-		AlignmentItem(GraphAlignerCommon<size_t, int32_t, uint64_t>::OnewayTrace&& trace, size_t cellsProcessed, size_t ms) :
+		AlignmentItem(GraphAlignerCommon<size_t, int32_t, uint64_t>::CompactTrace&& trace, size_t cellsProcessed, size_t ms) :
 		corrected(),
 		alignment(),
 		trace(),
@@ -294,7 +545,7 @@ public:
 		alignmentStart(0),
 		alignmentEnd(0)
 		{
-			this->trace = std::make_shared<GraphAlignerCommon<size_t, int32_t, uint64_t>::OnewayTrace>();
+			this->trace = std::make_shared<GraphAlignerCommon<size_t, int32_t, uint64_t>::CompactTrace>();
 			*this->trace = std::move(trace);
 		}
 		bool alignmentFailed() const
@@ -302,9 +553,8 @@ public:
 			return alignmentEnd == alignmentStart;
 		}
 		std::string corrected;
-		std::string GAFline;
 		std::shared_ptr<vg::Alignment> alignment;
-		std::shared_ptr<GraphAlignerCommon<size_t, int32_t, uint64_t>::OnewayTrace> trace;
+		std::shared_ptr<GraphAlignerCommon<size_t, int32_t, uint64_t>::CompactTrace> trace;
 		size_t cellsProcessed;
 		size_t elapsedMilliseconds;
 		size_t alignmentStart;
@@ -15,195 +15,120 @@ class GraphAlignerGAFAlignment
 	using Common = GraphAlignerCommon<LengthType, ScoreType, Word>;
 	using Params = typename Common::Params;
 	using MatrixPosition = typename Common::MatrixPosition;
-	using TraceItem = typename Common::TraceItem;
-	struct MergedNodePos
-	{
-		int nodeId;
-		bool reverse;
-		size_t nodeOffset;
-		size_t seqPos;
-	};
-	enum EditType
-	{
-		Match,
-		Mismatch,
-		Insertion,
-		Deletion,
-		Empty
-	};
+	using CompactTrace = typename Common::CompactTrace;
+	using RunType = typename CompactTrace::RunType;
 public:
 
-	static std::string traceToAlignment(const std::string& seq_id, const std::string& sequence, const GraphAlignerCommon<size_t, int32_t, uint64_t>::OnewayTrace& tracePair, const Params& params)
+	//appends the GAF line of the trace to out, without the line break
+	static void appendAlignment(std::string& out, const std::string& seq_id, size_t readLen, const CompactTrace& trace, const Params& params)
 	{
-		auto& trace = tracePair.trace;
-		if (trace.size() == 0) return nullptr;
-		std::string cigar;
-		std::string readName = seq_id;
-		size_t readLen = sequence.size();
-		size_t readStart = trace[0].DPposition.seqPos;
-		size_t readEnd = trace.back().DPposition.seqPos+1;
+		auto& runs = trace.runs;
+		assert(runs.size() > 0);
+		assert(runs[0].newNode);
+		//the cigar comes after the path statistics, so it is collected separately while the path goes straight to the output
+		thread_local std::string cigar;
+		cigar.clear();
+		size_t readStart = runs[0].seqPos;
+		size_t readEnd = runs.back().lastSeqPos()+1;
 		bool strand = true;
-		std::string nodePath;
 		size_t nodePathLen = 0;
-		size_t nodePathStart = trace[0].DPposition.nodeOffset;
+		size_t nodePathStart = runs[0].nodeOffset;
 		size_t nodePathEnd = 0;
 		size_t matches = 0;
-		size_t blockLength = trace.size();
+		size_t blockLength = 0;
 		int mappingQuality = 255;
 
-		MergedNodePos currentPos;
-		currentPos.nodeId = trace[0].DPposition.node;
-		currentPos.reverse = (trace[0].DPposition.node % 2) == 1;
-		currentPos.nodeOffset = trace[0].DPposition.nodeOffset;
-		currentPos.seqPos = trace[0].DPposition.seqPos;
-		EditType currentEdit = Empty;
-		size_t mismatches = 0;
-		size_t deletions = 0;
-		size_t insertions = 0;
+		out += seq_id;
+		out += '\t';
+		CommonUtils::AppendNumber(out, readLen);
+		out += '\t';
+		CommonUtils::AppendNumber(out, readStart);
+		out += '\t';
+		CommonUtils::AppendNumber(out, readEnd);
+		out += '\t';
+		out += (strand ? '+' : '-');
+		out += '\t';
+
+		RunType currentEdit = runs[0].type;
 		size_t editLength = 0;
-		if (Common::characterMatch(trace[0].sequenceCharacter, trace[0].graphCharacter))
-		{
-			currentEdit = Match;
-			editLength = 1;
-			matches += 1;
-		}
-		else
+		size_t currentNodeSize = 0;
+		for (size_t i = 0; i < runs.size(); i++)
 		{
-			currentEdit = Mismatch;
-			editLength = 1;
-			mismatches += 1;
-		}
-		nodePath += posToString(currentPos, params);
-		nodePathLen += params.graph.originalNodeSize.at(currentPos.nodeId);
-		for (size_t pos = 1; pos < trace.size(); pos++)
-		{
-			assert(trace[pos].DPposition.seqPos < sequence.size());
-			MergedNodePos newPos;
-			newPos.nodeId = trace[pos].DPposition.node;
-			newPos.reverse = (trace[pos].DPposition.node % 2) == 1;
-			newPos.nodeOffset = trace[pos].DPposition.nodeOffset;
-			newPos.seqPos = trace[pos].DPposition.seqPos;
-			bool insideNode = !trace[pos-1].nodeSwitch || (newPos.nodeId == currentPos.nodeId && newPos.reverse == currentPos.reverse && newPos.nodeOffset > currentPos.nodeOffset);
-
-			assert(newPos.seqPos >= currentPos.seqPos);
-
-			if (!insideNode)
+			const auto& run = runs[i];
+			assert(run.lastSeqPos() < readLen);
+			if (run.newNode)
 			{
-				size_t skippedBefore = params.graph.originalNodeSize.at(currentPos.nodeId) - 1 - trace[pos-1].DPposition.nodeOffset;
-				currentPos = newPos;
-				nodePath += posToString(currentPos, params);
-				assert(trace[pos].DPposition.nodeOffset < params.graph.originalNodeSize.at(currentPos.nodeId));
-				size_t skippedAfter = trace[pos].DPposition.nodeOffset;
-				nodePathLen += params.graph.originalNodeSize.at(currentPos.nodeId) - (skippedBefore + skippedAfter);
+				size_t skippedBefore = 0;
+				if (i > 0) skippedBefore = currentNodeSize - 1 - runs[i-1].lastNodeOffset();
+				appendPos(out, run.node, params);
+				currentNodeSize = params.graph.originalNodeSize.at(run.node);
+				assert(run.nodeOffset < currentNodeSize);
+				size_t skippedAfter = (i > 0) ? run.nodeOffset : 0;
+				nodePathLen += currentNodeSize - (skippedBefore + skippedAfter);
 			}
-
-			if (trace[pos-1].DPposition.seqPos == trace[pos].DPposition.seqPos)
+			if (run.type != currentEdit)
 			{
-				if (currentEdit == Empty) currentEdit = Deletion;
-				if (currentEdit != Deletion)
-				{
-					cigar += cigarItem(editLength, currentEdit);
-					currentEdit = Deletion;
-					editLength = 0;
-				}
-				editLength += 1;
-				deletions += 1;
-			}
-			else if (insideNode && trace[pos-1].DPposition.nodeOffset == trace[pos].DPposition.nodeOffset)
-			{
-				if (currentEdit == Empty) currentEdit = Insertion;
-				if (currentEdit != Insertion)
-				{
-					cigar += cigarItem(editLength, currentEdit);
-					currentEdit = Insertion;
-					editLength = 0;
-				}
-				editLength += 1;
-				insertions += 1;
-			}
-			else if (Common::characterMatch(trace[pos].sequenceCharacter, trace[pos].graphCharacter))
-			{
-				if (currentEdit == Empty) currentEdit = Match;
-				if (currentEdit != Match)
-				{
-					cigar += cigarItem(editLength, currentEdit);
-					currentEdit = Match;
-					editLength = 0;
-				}
-				editLength += 1;
-				matches += 1;
-			}
-			else
-			{
-				if (currentEdit == Empty) currentEdit = Mismatch;
-				if (currentEdit != Mismatch)
-				{
-					cigar += cigarItem(editLength, currentEdit);
-					currentEdit = Mismatch;
-					editLength = 0;
-				}
-				editLength += 1;
-				mismatches += 1;
-			}
-			if (insideNode)
-			{
-				assert(trace[pos-1].nodeSwitch || newPos.nodeId == currentPos.nodeId);
-				assert(trace[pos-1].nodeSwitch || newPos.reverse == currentPos.reverse);
+				appendCigarItem(cigar, editLength, currentEdit);
+				currentEdit = run.type;
+				editLength = 0;
 			}
+			editLength += run.length;
+			blockLength += run.length;
+			if (run.type == CompactTrace::Match) matches += run.length;
 		}
+		appendCigarItem(cigar, editLength, currentEdit);
 
-		assert(matches + mismatches + deletions + insertions == trace.size());
-		cigar += cigarItem(editLength, currentEdit);
+		nodePathEnd = nodePathLen - (params.graph.originalNodeSize.at(runs.back().node) - 1 - runs.back().lastNodeOffset());
 
-		nodePathEnd = nodePathLen - (params.graph.originalNodeSize.at(trace.back().DPposition.node) - 1 - trace.back().DPposition.nodeOffset);
-
-		std::stringstream sstr;
-		sstr << readName << "\t" << readLen << "\t" << readStart << "\t" << readEnd << "\t" << (strand ? "+" : "-") << "\t" << nodePath << "\t" << nodePathLen << "\t" << nodePathStart << "\t" << nodePathEnd << "\t" << matches << "\t" << blockLength << "\t" << mappingQuality << "\t" << "cg:Z:" << cigar;
-		return sstr.str();
+		out += '\t';
+		CommonUtils::AppendNumber(out, nodePathLen);
+		out += '\t';
+		CommonUtils::AppendNumber(out, nodePathStart);
+		out += '\t';
+		CommonUtils::AppendNumber(out, nodePathEnd);
+		out += '\t';
+		CommonUtils::AppendNumber(out, matches);
+		out += '\t';
+		CommonUtils::AppendNumber(out, blockLength);
+		out += '\t';
+		CommonUtils::AppendNumber(out, mappingQuality);
+		out += "\tcg:Z:";
+		out += cigar;
 	}
 
 private:
 
-	static std::string posToString(MergedNodePos pos, const Params& params)
+	static void appendPos(std::string& out, size_t nodeId, const Params& params)
 	{
-		std::string result;
-		if (pos.reverse)
+		out += ((nodeId % 2) == 1 ? '<' : '>');
+		const std::string& nodeName = params.graph.originalNodeName.at(nodeId);
+		if (nodeName == "")
 		{
-			result += "<";
+			CommonUtils::AppendNumber(out, nodeId/2);
 		}
 		else
 		{
-			result += ">";
+			out += nodeName;
 		}
-		std::string nodeName = params.graph.originalNodeName.at(pos.nodeId);
-		if (nodeName == "") nodeName = std::to_string(pos.nodeId/2);
-		result += nodeName;
-		return result;
 	}
 
-	static std::string cigarItem(size_t editLength, EditType type)
+	static void appendCigarItem(std::string& out, size_t editLength, RunType type)
 	{
-		if (editLength == 0) return "";
-		std::string result = std::to_string(editLength);
+		if (editLength == 0) return;
+		CommonUtils::AppendNumber(out, editLength);
 		switch(type)
 		{
-			case Match:
-				result += "M";
-				break;
-			case Mismatch:
-				result += "M";
+			case CompactTrace::Match:
+			case CompactTrace::Mismatch:
+				out += 'M';
 				break;
-			case Insertion:
-				result += "I";
+			case CompactTrace::Insertion:
+				out += 'I';
 				break;
-			case Deletion:
-				result += "D";
+			case CompactTrace::Deletion:
+				out += 'D';
 				break;
-			case Empty:
-			default:
-				return "";
 		}
-		return result;
 	}
 };
 
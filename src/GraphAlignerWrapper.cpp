@@ -1,41 +1,48 @@
-//split this here so modifying GraphAligner.h doesn't require recompiling every cpp file
-
-#include <limits>
-#include "GraphAlignerWrapper.h"
-#include "GraphAligner.h"
-#include "ThreadReadAssertion.h"
-
-AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t initialBandwidth, size_t rampBandwidth, bool quietMode, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, bool lowMemory, bool forceGlobal, bool preciseClipping)
-{
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {initialBandwidth, rampBandwidth, graph, std::numeric_limits<size_t>::max(), quietMode, false, lowMemory, forceGlobal, preciseClipping};
-	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
-	return aligner.AlignOneWay(seq_id, sequence, reusableState);
-}
-
-AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t initialBandwidth, size_t rampBandwidth, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, bool lowMemory, bool forceGlobal, bool preciseClipping)
-{
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {initialBandwidth, rampBandwidth, graph, maxCellsPerSlice, quietMode, sloppyOptimizations, lowMemory, forceGlobal, preciseClipping};
-	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
-	return aligner.AlignOneWay(seq_id, sequence, seedHits, reusableState);
-}
-
-void AddAlignment(const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment)
-{
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 1, AlignmentGraph::DummyGraph(), 1, true, true, true, false, false};
-	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
-	aligner.AddAlignment(seq_id, sequence, alignment);
-}
-
-void AddGAFLine(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment)
-{
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 1, graph, 1, true, true, true, false, false};
-	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
-	aligner.AddGAFLine(seq_id, sequence, alignment);
-}
-
-void AddCorrected(AlignmentResult::AlignmentItem& alignment)
-{
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 1, AlignmentGraph::DummyGraph(), 1, true, true, true, false, false};
-	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
-	aligner.AddCorrected(alignment);
-}
+//split this here so modifying GraphAligner.h doesn't require recompiling every cpp file
+
+#include <limits>
+#include "GraphAlignerWrapper.h"
+#include "GraphAligner.h"
+#include "ThreadReadAssertion.h"
+
+AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t initialBandwidth, size_t rampBandwidth, bool quietMode, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, bool lowMemory, bool forceGlobal, bool preciseClipping)
+{
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {initialBandwidth, rampBandwidth, graph, std::numeric_limits<size_t>::max(), quietMode, false, lowMemory, forceGlobal, preciseClipping};
+	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
+	return aligner.AlignOneWay(seq_id, sequence, reusableState);
+}
+
+AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t initialBandwidth, size_t rampBandwidth, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, bool lowMemory, bool forceGlobal, bool preciseClipping, AlignmentTaskPool* taskPool)
+{
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {initialBandwidth, rampBandwidth, graph, maxCellsPerSlice, quietMode, sloppyOptimizations, lowMemory, forceGlobal, preciseClipping};
+	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
+	return aligner.AlignOneWay(seq_id, sequence, seedHits, reusableState, taskPool);
+}
+
+void AddAlignment(const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment, google::protobuf::Arena* arena)
+{
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 1, AlignmentGraph::DummyGraph(), 1, true, true, true, false, false};
+	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
+	aligner.AddAlignment(seq_id, sequence, alignment, arena);
+}
+
+void AppendGAFLine(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, const AlignmentResult::AlignmentItem& alignment, std::string& out)
+{
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 1, graph, 1, true, true, true, false, false};
+	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
+	aligner.AppendGAFLine(seq_id, sequence, alignment, out);
+}
+
+void AppendBinaryRecord(const std::string& seq_id, const AlignmentResult::AlignmentItem& alignment, std::string& out)
+{
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 1, AlignmentGraph::DummyGraph(), 1, true, true, true, false, false};
+	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
+	aligner.AppendBinaryRecord(seq_id, alignment, out);
+}
+
+void AddCorrected(const AlignmentGraph& graph, AlignmentResult::AlignmentItem& alignment)
+{
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 1, graph, 1, true, true, true, false, false};
+	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
+	aligner.AddCorrected(alignment);
+}
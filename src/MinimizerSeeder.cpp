@@ -1,5 +1,6 @@
 #include <thread>
 #include <cmath>
+#include <deque>
 #include <concurrentqueue.h>
 #include "CommonUtils.h"
 #include "MinimizerSeeder.h"
@@ -177,15 +178,140 @@ start:
 	}
 }
 
-MinimizerSeeder::MinimizerSeeder(const AlignmentGraph& graph, size_t minimizerLength, size_t windowSize, size_t numThreads) :
+// walks forward from the end of the node over the edges and reports the minimizers which span at least one edge
+// the walk starts windowSize-1 bp before the end of the node and extends windowSize-1 bp past it, so every window containing
+// an edge-spanning k-mer that starts in this node is inside some walk. k-mers are reported at their first base
+// syncmers don't depend on a window so the walk only needs to cover the k-mer
+// returns false if the walks were cut off at MaxWalksPerNode, in which case some edge-spanning minimizers were not reported
+template <typename F>
+bool MinimizerSeeder::iterateEdgeSpanningMinimizers(int nodeId, const std::string& nodeSequence, F callback) const
+{
+	size_t extension = (smerLength > 0 ? minimizerLength : windowSize) - 1;
+	size_t tailStart = nodeSequence.size() > extension ? nodeSequence.size() - extension : 0;
+	std::string walk = nodeSequence.substr(tailStart);
+	//split node and offset in split node for each base in the walk
+	std::vector<std::pair<size_t, size_t>> walkPositions;
+	//number of edges crossed before each base in the walk
+	std::vector<size_t> walkEdges;
+	for (size_t pos = tailStart; pos < nodeSequence.size(); pos++)
+	{
+		size_t splitNode = graph.GetUnitigNode(nodeId, pos);
+		walkPositions.emplace_back(splitNode, pos - graph.nodeOffset[splitNode]);
+		walkEdges.push_back(0);
+	}
+	size_t maxWalkLength = walk.size() + extension;
+	size_t walksDone = 0;
+	//split node, walk length before the split node
+	std::vector<std::pair<size_t, size_t>> stack;
+	for (auto neighbor : graph.outNeighbors[graph.nodeLookup.at(nodeId).back()])
+	{
+		stack.emplace_back(neighbor, walk.size());
+	}
+	while (stack.size() > 0 && walksDone < MaxWalksPerNode)
+	{
+		auto top = stack.back();
+		stack.pop_back();
+		size_t node = top.first;
+		walk.resize(top.second);
+		walkPositions.resize(top.second);
+		walkEdges.resize(top.second);
+		assert(walk.size() > 0);
+		size_t previous = walkPositions.back().first;
+		size_t edges = walkEdges.back();
+		//the last split node of an original node only has edges to other nodes
+		if (graph.nodeOffset[previous] + graph.NodeLength(previous) == graph.originalNodeSize.at(graph.nodeIDs[previous])) edges += 1;
+		for (size_t offset = 0; offset < graph.NodeLength(node) && walk.size() < maxWalkLength; offset++)
+		{
+			walk += graph.NodeSequences(node, offset);
+			walkPositions.emplace_back(node, offset);
+			walkEdges.push_back(edges);
+		}
+		if (walk.size() < maxWalkLength && graph.outNeighbors[node].size() > 0)
+		{
+			for (auto neighbor : graph.outNeighbors[node])
+			{
+				stack.emplace_back(neighbor, walk.size());
+			}
+			continue;
+		}
+		walksDone += 1;
+		iterateIndexedKmers(walk, [this, &walkPositions, &walkEdges, callback](size_t pos, size_t kmer)
+		{
+			size_t start = pos + 1 - minimizerLength;
+			if (walkEdges[start] == walkEdges[pos]) return;
+			assert(walkPositions[start].second < 64);
+			callback(kmer, walkPositions[start].first, walkPositions[start].second);
+		});
+	}
+	return stack.size() == 0;
+}
+
+// closed syncmers: k-mers whose smallest s-mer is either the first or the last s-mer in the k-mer
+// the callback gets the position of the last base of the k-mer, like in iterateMinimizers
+template <typename CallbackF>
+void iterateClosedSyncmers(const std::string& str, size_t syncmerLength, size_t smerLength, CallbackF callback)
+{
+	assert(syncmerLength * 2 <= sizeof(size_t) * 8);
+	assert(smerLength < syncmerLength);
+	size_t kmerMask = ~(0xFFFFFFFFFFFFFFFF << (syncmerLength * 2));
+	size_t smerMask = ~(0xFFFFFFFFFFFFFFFF << (smerLength * 2));
+	size_t smersInKmer = syncmerLength - smerLength + 1;
+	size_t kmer = 0;
+	size_t validLength = 0;
+	//end position and hash of the s-mers which can still be the smallest, hashes increasing
+	std::deque<std::pair<size_t, size_t>> minSmers;
+	for (size_t i = 0; i < str.size(); i++)
+	{
+		if (!validChar[str[i]])
+		{
+			kmer = 0;
+			validLength = 0;
+			minSmers.clear();
+			continue;
+		}
+		kmer <<= 2;
+		kmer &= kmerMask;
+		kmer |= charToInt(str[i]);
+		validLength += 1;
+		if (validLength < smerLength) continue;
+		size_t smerHash = hash(kmer & smerMask);
+		while (minSmers.size() > 0 && minSmers.back().second > smerHash) minSmers.pop_back();
+		minSmers.emplace_back(i, smerHash);
+		while (minSmers.front().first + smersInKmer <= i) minSmers.pop_front();
+		if (validLength < syncmerLength) continue;
+		size_t firstSmerEnd = i + 1 - smersInKmer;
+		bool smallestFirst = minSmers.front().first == firstSmerEnd;
+		bool smallestLast = minSmers.back().first == i && minSmers.back().second == minSmers.front().second;
+		if (smallestFirst || smallestLast) callback(i, kmer);
+	}
+}
+
+template <typename CallbackF>
+void MinimizerSeeder::iterateIndexedKmers(const std::string& str, CallbackF callback) const
+{
+	if (smerLength > 0)
+	{
+		iterateClosedSyncmers(str, minimizerLength, smerLength, callback);
+	}
+	else
+	{
+		iterateMinimizers(str, minimizerLength, windowSize, callback);
+	}
+}
+
+MinimizerSeeder::MinimizerSeeder(const AlignmentGraph& graph, size_t minimizerLength, size_t windowSize, size_t smerLength, size_t numThreads, bool spanEdges) :
 graph(graph),
 buckets(),
 minimizerLength(minimizerLength),
 windowSize(windowSize),
-maxCount(0)
+smerLength(smerLength),
+maxCount(0),
+spanEdges(spanEdges),
+truncatedWalkNodes(0)
 {
 	assert(minimizerLength * 2 <= sizeof(size_t) * 8);
-	assert(minimizerLength <= windowSize);
+	assert(smerLength > 0 || minimizerLength <= windowSize);
+	assert(smerLength < minimizerLength);
 	initMinimizers(numThreads);
 	initMaxCount();
 }
@@ -193,7 +319,8 @@ maxCount(0)
 void MinimizerSeeder::initMinimizers(size_t numThreads)
 {
 	size_t positionSize = log2(graph.nodeIDs.size()) + 1;
-	assert(positionSize + 6 < 64);
+	//split node, edge-spanning flag, offset in split node
+	assert(positionSize + 7 < 64);
 	assert(minimizerLength * 2 < 64);
 	auto nodeIter = graph.nodeLookup.begin();
 	std::mutex nodeMutex;
@@ -207,16 +334,18 @@ void MinimizerSeeder::initMinimizers(size_t numThreads)
 	buckets.resize(numThreads);
 	std::atomic<size_t> threadsDone;
 	threadsDone = 0;
+	std::atomic<size_t> truncatedNodes;
+	truncatedNodes = 0;
 	for (size_t i = 0; i < numThreads; i++)
 	{
 		kmerPerBucket[i].width(minimizerLength * 2);
-		positionPerBucket[i].width(positionSize + 6);
-		buckets[i].positions.width(positionSize + 6);
+		positionPerBucket[i].width(positionSize + 7);
+		buckets[i].positions.width(positionSize + 7);
 	}
 
 	for (size_t thread = 0; thread < numThreads; thread++)
 	{
-		threads.emplace_back([this, &positionDistributor, &threadsDone, &kmerPerBucket, &positionPerBucket, thread, numThreads, &nodeMutex, &nodeIter, positionSize](){
+		threads.emplace_back([this, &positionDistributor, &threadsDone, &truncatedNodes, &kmerPerBucket, &positionPerBucket, thread, numThreads, &nodeMutex, &nodeIter, positionSize](){
 			size_t vecPos = 0;
 			kmerPerBucket[thread].resize(10);
 			positionPerBucket[thread].resize(10);
@@ -239,11 +368,9 @@ void MinimizerSeeder::initMinimizers(size_t numThreads)
 					size_t nodeidHere = graph.GetUnitigNode(nodeId, pos);
 					sequence[pos] = graph.NodeSequences(nodeidHere, pos - graph.nodeOffset[nodeidHere]);
 				}
-				iterateMinimizers(sequence, minimizerLength, windowSize, [this, &positionDistributor, &kmerPerBucket, &positionPerBucket, &vecPos, positionSize, thread, nodeId](size_t pos, size_t kmer)
+				auto storeMinimizer = [this, &positionDistributor, &kmerPerBucket, &positionPerBucket, &vecPos, positionSize, thread](size_t kmer, size_t splitNode, size_t remainingOffset, bool edgeSpanning)
 				{
-					size_t splitNode = graph.GetUnitigNode(nodeId, pos);
 					assert(splitNode < (size_t)1 << positionSize);
-					size_t remainingOffset = pos - graph.nodeOffset[splitNode];
 					assert(remainingOffset < 64);
 					std::pair<uint64_t, uint64_t> readThis;
 					while (positionDistributor[thread].try_dequeue(readThis))
@@ -264,10 +391,25 @@ void MinimizerSeeder::initMinimizers(size_t numThreads)
 					storeThis.first = kmer;
 					size_t bucket = getBucket(kmer);
 					storeThis.second = splitNode;
+					storeThis.second <<= 1;
+					storeThis.second += edgeSpanning ? 1 : 0;
 					storeThis.second <<= 6;
 					storeThis.second += remainingOffset;
 					positionDistributor[bucket].enqueue(storeThis);
+				};
+				iterateIndexedKmers(sequence, [this, nodeId, &storeMinimizer](size_t pos, size_t kmer)
+				{
+					size_t splitNode = graph.GetUnitigNode(nodeId, pos);
+					storeMinimizer(kmer, splitNode, pos - graph.nodeOffset[splitNode], false);
 				});
+				if (spanEdges)
+				{
+					bool complete = iterateEdgeSpanningMinimizers(nodeId, sequence, [&storeMinimizer](size_t kmer, size_t splitNode, size_t offset)
+					{
+						storeMinimizer(kmer, splitNode, offset, true);
+					});
+					if (!complete) truncatedNodes += 1;
+				}
 			}
 			threadsDone += 1;
 			while (threadsDone < numThreads)
@@ -302,6 +444,24 @@ void MinimizerSeeder::initMinimizers(size_t numThreads)
 				positionPerBucket[thread][vecPos] = readThis.second;
 				vecPos += 1;
 			}
+			if (spanEdges)
+			{
+				//overlapping walks find the same edge-spanning minimizer multiple times
+				std::vector<std::pair<uint64_t, uint64_t>> pairs;
+				pairs.reserve(vecPos);
+				for (size_t i = 0; i < vecPos; i++)
+				{
+					pairs.emplace_back(kmerPerBucket[thread][i], positionPerBucket[thread][i]);
+				}
+				std::sort(pairs.begin(), pairs.end());
+				pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+				vecPos = pairs.size();
+				for (size_t i = 0; i < vecPos; i++)
+				{
+					kmerPerBucket[thread][i] = pairs[i].first;
+					positionPerBucket[thread][i] = pairs[i].second;
+				}
+			}
 			kmerPerBucket[thread].resize(vecPos);
 			positionPerBucket[thread].resize(vecPos);
 			{
@@ -369,6 +529,7 @@ void MinimizerSeeder::initMinimizers(size_t numThreads)
 		threads[i].join();
 	}
 	threads.clear();
+	truncatedWalkNodes = truncatedNodes;
 }
 
 std::vector<SeedHit> MinimizerSeeder::getSeeds(const std::string& sequence, size_t maxCount, size_t chunkSize) const
@@ -383,7 +544,7 @@ std::vector<SeedHit> MinimizerSeeder::getSeeds(const std::string& sequence, size
 	size_t lastChainCount = 0;
 	size_t lastChainKmer = 0;
 	size_t lastChainChunk = 0;
-	iterateMinimizers(sequence, minimizerLength, windowSize, [this, &matchIndices, bpPerChunk, &lastChainNodeId, &lastChainNodeOffset, &lastChainReadPos, &lastChainCount, &lastChainKmer, &lastChainChunk](size_t pos, size_t kmer)
+	iterateIndexedKmers(sequence, [this, &matchIndices, bpPerChunk, &lastChainNodeId, &lastChainNodeOffset, &lastChainReadPos, &lastChainCount, &lastChainKmer, &lastChainChunk](size_t pos, size_t kmer)
 	{
 		volatile size_t bucket = getBucket(kmer);
 		assert(bucket < buckets.size());
@@ -403,14 +564,17 @@ std::vector<SeedHit> MinimizerSeeder::getSeeds(const std::string& sequence, size
 			return;
 		}
 		size_t splitpos = buckets[bucket].positions[getStart(bucket, index)];
-		size_t splitNodeId = pos >> 6;
-		size_t splitOffset = pos & 63;
+		size_t splitNodeId = splitpos >> 7;
+		size_t splitOffset = splitpos & 63;
+		bool edgeSpanning = (splitpos >> 6) & 1;
 		size_t nodeOffset = graph.nodeOffset[splitNodeId] + splitOffset;
 		size_t nodeId = graph.nodeIDs[splitNodeId];
 		do
 		{
 			// unique
 			if (count != 1) break;
+			// edge-spanning minimizers are stored at their start, don't mix them with the in-node ones
+			if (edgeSpanning) break;
 			// right orientation in read
 			if (pos <= lastChainReadPos) break;
 			// same node
@@ -430,7 +594,8 @@ std::vector<SeedHit> MinimizerSeeder::getSeeds(const std::string& sequence, size
 			if (lastChainCount > 0) matchIndices[lastChainChunk].emplace_back(lastChainReadPos, lastChainKmer, 1, lastChainCount);
 			lastChainCount = 0;
 		}
-		lastChainNodeId = nodeId;
+		// edge-spanning minimizers never chain with the next one either
+		lastChainNodeId = edgeSpanning ? std::numeric_limits<size_t>::max() : nodeId;
 		lastChainNodeOffset = nodeOffset;
 		lastChainReadPos = pos;
 		lastChainCount += 1;
@@ -459,9 +624,12 @@ std::vector<SeedHit> MinimizerSeeder::getSeeds(const std::string& sequence, size
 			{
 				if (seedsHere >= maxCount) break;
 				size_t mergepos = buckets[bucket].positions[i];
-				size_t nodeId = mergepos >> 6;
+				size_t nodeId = mergepos >> 7;
 				size_t offset = mergepos & 63;
-				result.push_back(matchToSeedHit(nodeId, offset, std::get<0>(match), std::get<2>(match)));
+				size_t seqPos = std::get<0>(match);
+				// edge-spanning minimizers are indexed at their first base, the read position is at the last base
+				if ((mergepos >> 6) & 1) seqPos -= minimizerLength - 1;
+				result.push_back(matchToSeedHit(nodeId, offset, seqPos, std::get<2>(match)));
 				seedsHere += 1;
 			}
 			if (seedsHere >= maxCount) break;
@@ -502,6 +670,11 @@ size_t MinimizerSeeder::getBucket(size_t hash) const
 	return hash % buckets.size();
 }
 
+size_t MinimizerSeeder::getTruncatedWalkNodes() const
+{
+	return truncatedWalkNodes;
+}
+
 MinimizerSeeder::KmerBucket::KmerBucket() :
 	locator(nullptr)
 {}
@@ -30,19 +30,31 @@ class MinimizerSeeder
 		sdsl::int_vector<0> positions;
 	};
 public:
-	MinimizerSeeder(const AlignmentGraph& graph, size_t minimizerLength, size_t windowSize, size_t numThreads);
+	//smerLength > 0 indexes closed syncmers with s-mers of that length instead of window minimizers
+	MinimizerSeeder(const AlignmentGraph& graph, size_t minimizerLength, size_t windowSize, size_t smerLength, size_t numThreads, bool spanEdges);
 	std::vector<SeedHit> getSeeds(const std::string& sequence, size_t maxCount, size_t chunkSize) const;
+	//number of nodes whose edge-spanning minimizers were only partially indexed because they had more than MaxWalksPerNode walks
+	size_t getTruncatedWalkNodes() const;
 private:
 	size_t getStart(size_t bucket, size_t index) const;
 	size_t getBucket(size_t hash) const;
 	SeedHit matchToSeedHit(int nodeId, size_t nodeOffset, size_t seqPos, int count) const;
+	template <typename F>
+	void iterateIndexedKmers(const std::string& str, F callback) const;
+	template <typename F>
+	bool iterateEdgeSpanningMinimizers(int nodeId, const std::string& nodeSequence, F callback) const;
 	void initMinimizers(size_t numThreads);
 	void initMaxCount();
 	const AlignmentGraph& graph;
 	std::vector<KmerBucket> buckets;
 	size_t minimizerLength;
 	size_t windowSize;
+	size_t smerLength;
 	size_t maxCount;
+	bool spanEdges;
+	size_t truncatedWalkNodes;
+	//max number of walks enumerated from the end of a node when indexing edge-spanning minimizers
+	static constexpr size_t MaxWalksPerNode = 64;
 };
 
 #endif
@@ -1,10 +1,48 @@
 #include <iostream>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/serialization/vector.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "CommonUtils.h"
 #include "MummerSeeder.h"
 
+//binary .aux cache: header, sequence + '\0' padded to 8 bytes, node positions as uint64, node ids as int64
+//everything is 8-byte aligned so the file can be mmapped and used in place
+struct MummerCacheHeader
+{
+	char magic[8];
+	uint64_t version;
+	uint64_t sparseness;
+	uint64_t seqLength;
+	uint64_t numNodePositions;
+	uint64_t numNodeIDs;
+	uint64_t checksum;
+};
+
+const char MummerCacheMagic[8] = { 'G', 'A', 'M', 'X', 'A', 'U', 'X', '\0' };
+const uint64_t MummerCacheVersion = 2;
+
+//FNV-1a over 64-bit words
+uint64_t cacheChecksum(uint64_t checksum, const char* data, size_t length)
+{
+	assert(length % 8 == 0);
+	for (size_t i = 0; i < length; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		checksum ^= word;
+		checksum *= 1099511628211ull;
+	}
+	return checksum;
+}
+
+size_t paddedSeqLength(size_t seqLength)
+{
+	return (seqLength + 1 + 7) / 8 * 8;
+}
+
 char lowercaseRef(char c)
 {
 	switch(c)
@@ -62,66 +100,96 @@ bool fileExists(const std::string& fileName)
 	return file.good();
 }
 
-MummerSeeder::MummerSeeder(const GfaGraph& graph, const std::string& cachePrefix)
+MummerSeeder::MummerSeeder(const GfaGraph& graph, const std::string& cachePrefix, size_t sparseness) :
+seq(),
+seqData(nullptr),
+seqLength(0),
+mappedCache(nullptr),
+mappedCacheSize(0),
+sparseness(sparseness)
 {
-	if (cachePrefix.size() > 0 && fileExists(cachePrefix + ".aux"))
-	{
-		loadFrom(cachePrefix);
-	}
-	else
-	{
-		initTree(graph);
-		if (cachePrefix.size() > 0) saveTo(cachePrefix);
-	}
+	if (cachePrefix.size() > 0 && fileExists(cachePrefix + ".aux") && loadFrom(cachePrefix)) return;
+	initTree(graph);
+	if (cachePrefix.size() > 0) saveTo(cachePrefix);
 }
 
-MummerSeeder::MummerSeeder(const vg::Graph& graph, const std::string& cachePrefix)
+MummerSeeder::MummerSeeder(const vg::Graph& graph, const std::string& cachePrefix, size_t sparseness) :
+seq(),
+seqData(nullptr),
+seqLength(0),
+mappedCache(nullptr),
+mappedCacheSize(0),
+sparseness(sparseness)
 {
-	if (cachePrefix.size() > 0 && fileExists(cachePrefix + ".aux"))
-	{
-		loadFrom(cachePrefix);
-	}
-	else
-	{
-		initTree(graph);
-		if (cachePrefix.size() > 0) saveTo(cachePrefix);
-	}
+	if (cachePrefix.size() > 0 && fileExists(cachePrefix + ".aux") && loadFrom(cachePrefix)) return;
+	initTree(graph);
+	if (cachePrefix.size() > 0) saveTo(cachePrefix);
+}
+
+MummerSeeder::~MummerSeeder()
+{
+	//the matcher points into the mapped memory
+	matcher.reset();
+	unmapCache();
+}
+
+void MummerSeeder::unmapCache()
+{
+	if (mappedCache != nullptr) munmap(mappedCache, mappedCacheSize);
+	mappedCache = nullptr;
+	mappedCacheSize = 0;
 }
 
 void MummerSeeder::initTree(const GfaGraph& graph)
 {
-	for (auto node : graph.nodes)
+	std::vector<const std::string*> nodeSequences;
+	nodeSequences.reserve(graph.nodes.size());
+	nodeIDs.reserve(graph.nodes.size());
+	for (const auto& node : graph.nodes)
 	{
-		nodePositions.push_back(seq.size());
 		nodeIDs.push_back(node.first);
-		seq += node.second;
-		seq += '`';
-	}
-	nodePositions.push_back(seq.size());
-	for (size_t i = 0; i < seq.size(); i++)
-	{
-		seq[i] = lowercaseRef(seq[i]);
+		nodeSequences.push_back(&node.second);
 	}
-	seq.shrink_to_fit();
-	matcher = std::make_unique<mummer::mummer::sparseSA>(mummer::mummer::sparseSA::create_auto(seq.c_str(), seq.size(), 0, true));
+	initTree(nodeSequences);
 }
 
 void MummerSeeder::initTree(const vg::Graph& graph)
 {
+	std::vector<const std::string*> nodeSequences;
+	nodeSequences.reserve(graph.node_size());
+	nodeIDs.reserve(graph.node_size());
 	for (int i = 0; i < graph.node_size(); i++)
 	{
-		nodePositions.push_back(seq.size());
 		nodeIDs.push_back(graph.node(i).id());
-		seq += graph.node(i).sequence();
-		seq += '`';
+		nodeSequences.push_back(&graph.node(i).sequence());
 	}
-	nodePositions.push_back(seq.size());
-	for (size_t i = 0; i < seq.size(); i++)
+	initTree(nodeSequences);
+}
+
+void MummerSeeder::initTree(const std::vector<const std::string*>& nodeSequences)
+{
+	nodePositions.reserve(nodeSequences.size() + 1);
+	size_t totalLength = 0;
+	for (auto sequence : nodeSequences)
+	{
+		nodePositions.push_back(totalLength);
+		totalLength += sequence->size() + 1;
+	}
+	nodePositions.push_back(totalLength);
+	seq.resize(totalLength);
+	for (size_t i = 0; i < nodeSequences.size(); i++)
 	{
-		seq[i] = lowercaseRef(seq[i]);
+		const std::string& nodeSeq = *nodeSequences[i];
+		size_t start = nodePositions[i];
+		for (size_t j = 0; j < nodeSeq.size(); j++)
+		{
+			seq[start + j] = lowercaseRef(nodeSeq[j]);
+		}
+		seq[start + nodeSeq.size()] = '`';
 	}
-	seq.shrink_to_fit();
-	matcher = std::make_unique<mummer::mummer::sparseSA>(mummer::mummer::sparseSA::create_auto(seq.c_str(), seq.size(), 0, true));
+	seqData = seq.c_str();
+	seqLength = seq.size();
+	matcher = std::make_unique<mummer::mummer::sparseSA>(mummer::mummer::sparseSA::create_auto(seqData, seqLength, 0, true, sparseness));
 }
 
 size_t MummerSeeder::getNodeIndex(size_t indexPos) const
@@ -136,28 +204,122 @@ size_t MummerSeeder::getNodeIndex(size_t indexPos) const
 
 void MummerSeeder::saveTo(const std::string& prefix) const
 {
-	std::ofstream file { prefix + ".aux", std::ios::binary };
+	std::vector<char> paddedSeq;
+	paddedSeq.resize(paddedSeqLength(seqLength), 0);
+	memcpy(paddedSeq.data(), seqData, seqLength);
+	std::vector<uint64_t> positions { nodePositions.begin(), nodePositions.end() };
+	std::vector<int64_t> ids { nodeIDs.begin(), nodeIDs.end() };
+	MummerCacheHeader header;
+	memcpy(header.magic, MummerCacheMagic, sizeof(header.magic));
+	header.version = MummerCacheVersion;
+	header.sparseness = sparseness;
+	header.seqLength = seqLength;
+	header.numNodePositions = positions.size();
+	header.numNodeIDs = ids.size();
+	header.checksum = 14695981039346656037ull;
+	header.checksum = cacheChecksum(header.checksum, paddedSeq.data(), paddedSeq.size());
+	header.checksum = cacheChecksum(header.checksum, (const char*)positions.data(), positions.size() * sizeof(uint64_t));
+	header.checksum = cacheChecksum(header.checksum, (const char*)ids.data(), ids.size() * sizeof(int64_t));
+	//the .aux file marks a complete cache, so it is written last and only appears once it is fully written.
+	//a stale one is removed first so it can't be paired with a half written index
+	std::remove((prefix + ".aux").c_str());
+	if (!matcher->save(prefix + "_index"))
+	{
+		std::cerr << "Could not save the MUM/MEM index to " << prefix << "_index" << std::endl;
+		return;
+	}
+	std::string tempName = prefix + ".aux.tmp";
+	{
+		std::ofstream file { tempName, std::ios::binary };
+		file.write((const char*)&header, sizeof(header));
+		file.write(paddedSeq.data(), paddedSeq.size());
+		file.write((const char*)positions.data(), positions.size() * sizeof(uint64_t));
+		file.write((const char*)ids.data(), ids.size() * sizeof(int64_t));
+		file.close();
+		if (!file)
+		{
+			std::cerr << "Could not write the MUM/MEM index cache to " << tempName << std::endl;
+			std::remove(tempName.c_str());
+			return;
+		}
+	}
+	if (std::rename(tempName.c_str(), (prefix + ".aux").c_str()) != 0)
 	{
-		boost::archive::text_oarchive oa(file);
-		oa << seq;
-		oa << nodePositions;
-		oa << nodeIDs;
+		std::cerr << "Could not rename " << tempName << " to " << prefix << ".aux" << std::endl;
+		std::remove(tempName.c_str());
 	}
-	matcher->save(prefix + "_index");
 }
 
-void MummerSeeder::loadFrom(const std::string& prefix)
+bool MummerSeeder::loadFrom(const std::string& prefix)
 {
-	std::ifstream file { prefix + ".aux", std::ios::binary };
+	std::string filename = prefix + ".aux";
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) return false;
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(MummerCacheHeader))
+	{
+		close(fd);
+		std::cerr << "MUM/MEM cache " << filename << " is not valid, rebuilding it" << std::endl;
+		return false;
+	}
+	mappedCacheSize = fileStat.st_size;
+	mappedCache = mmap(nullptr, mappedCacheSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mappedCache == MAP_FAILED)
+	{
+		mappedCache = nullptr;
+		mappedCacheSize = 0;
+		return false;
+	}
+	madvise(mappedCache, mappedCacheSize, MADV_WILLNEED);
+	const char* data = (const char*)mappedCache;
+	const MummerCacheHeader* header = (const MummerCacheHeader*)data;
+	if (memcmp(header->magic, MummerCacheMagic, sizeof(header->magic)) != 0 || header->version != MummerCacheVersion)
+	{
+		unmapCache();
+		std::cerr << "MUM/MEM cache " << filename << " is from a different version, rebuilding it" << std::endl;
+		return false;
+	}
+	if (header->sparseness != sparseness)
+	{
+		std::cerr << "MUM/MEM cache " << filename << " was built with sparseness " << header->sparseness << " instead of " << sparseness << ", rebuilding it" << std::endl;
+		unmapCache();
+		return false;
+	}
+	size_t seqBytes = paddedSeqLength(header->seqLength);
+	if (mappedCacheSize != sizeof(MummerCacheHeader) + seqBytes + header->numNodePositions * sizeof(uint64_t) + header->numNodeIDs * sizeof(int64_t) || header->numNodePositions != header->numNodeIDs + 1)
 	{
-		boost::archive::text_iarchive ia(file);
-		ia >> seq;
-		ia >> nodePositions;
-		ia >> nodeIDs;
+		unmapCache();
+		std::cerr << "MUM/MEM cache " << filename << " is truncated, rebuilding it" << std::endl;
+		return false;
 	}
+	const char* payload = data + sizeof(MummerCacheHeader);
+	if (cacheChecksum(14695981039346656037ull, payload, mappedCacheSize - sizeof(MummerCacheHeader)) != header->checksum)
+	{
+		unmapCache();
+		std::cerr << "MUM/MEM cache " << filename << " has a wrong checksum, rebuilding it" << std::endl;
+		return false;
+	}
+	seqData = payload;
+	seqLength = header->seqLength;
+	const uint64_t* positions = (const uint64_t*)(payload + seqBytes);
+	const int64_t* ids = (const int64_t*)(payload + seqBytes + header->numNodePositions * sizeof(uint64_t));
+	nodePositions.assign(positions, positions + header->numNodePositions);
+	nodeIDs.assign(ids, ids + header->numNodeIDs);
 	// same params that create_auto with minlen=0 passes
-	matcher = std::make_unique<mummer::mummer::sparseSA>(seq, false, 1, true, false, false, 1, 0, true);
-	matcher->load(prefix + "_index");
+	matcher = std::make_unique<mummer::mummer::sparseSA>(seqData, seqLength, false, sparseness, sparseness < 4, sparseness >= 4, false, 1, 0, true);
+	if (!matcher->load(prefix + "_index"))
+	{
+		matcher.reset();
+		nodePositions.clear();
+		nodeIDs.clear();
+		seqData = nullptr;
+		seqLength = 0;
+		unmapCache();
+		std::cerr << "MUM/MEM index " << prefix << "_index could not be loaded, rebuilding it" << std::endl;
+		return false;
+	}
+	return true;
 }
 
 struct MatchWithOrientation
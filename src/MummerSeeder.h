@@ -12,8 +12,12 @@
 class MummerSeeder
 {
 public:
-	MummerSeeder(const GfaGraph& graph, const std::string& cachePrefix);
-	MummerSeeder(const vg::Graph& graph, const std::string& cachePrefix);
+	//sparseness: only every sparseness'th suffix is indexed, matches shorter than that are not found
+	MummerSeeder(const GfaGraph& graph, const std::string& cachePrefix, size_t sparseness);
+	MummerSeeder(const vg::Graph& graph, const std::string& cachePrefix, size_t sparseness);
+	~MummerSeeder();
+	MummerSeeder(const MummerSeeder& other) = delete;
+	MummerSeeder& operator=(const MummerSeeder& other) = delete;
 	std::vector<SeedHit> getMemSeeds(std::string sequence, size_t maxCount, size_t minLen) const;
 	std::vector<SeedHit> getMumSeeds(std::string sequence, size_t maxCount, size_t minLen) const;
 private:
@@ -23,9 +27,17 @@ private:
 	size_t nodeLength(size_t indexPos) const;
 	void initTree(const GfaGraph& graph);
 	void initTree(const vg::Graph& graph);
+	void initTree(const std::vector<const std::string*>& nodeSequences);
 	void saveTo(const std::string& cachePrefix) const;
-	void loadFrom(const std::string& cachePrefix);
+	bool loadFrom(const std::string& cachePrefix);
+	void unmapCache();
+	//the matcher only keeps a pointer to the sequence, which is either in seq or in the mmapped cache
 	std::string seq;
+	const char* seqData;
+	size_t seqLength;
+	void* mappedCache;
+	size_t mappedCacheSize;
+	size_t sparseness;
 	std::unique_ptr<mummer::mummer::sparseSA> matcher;
 	std::vector<size_t> nodePositions;
 	std::vector<int> nodeIDs;
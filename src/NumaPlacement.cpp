@@ -0,0 +1,113 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include "NumaPlacement.h"
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#endif
+
+namespace
+{
+	const size_t MaxNodes = 1024;
+
+	//parses lists like "0-3,8,10-11"
+	std::vector<int> parseList(const std::string& list)
+	{
+		std::vector<int> result;
+		std::stringstream str { list };
+		std::string part;
+		while (std::getline(str, part, ','))
+		{
+			if (part.size() == 0 || part == "\n") continue;
+			size_t dash = part.find('-');
+			int start = std::stoi(part.substr(0, dash));
+			int end = (dash == std::string::npos) ? start : std::stoi(part.substr(dash+1));
+			for (int i = start; i <= end; i++) result.push_back(i);
+		}
+		return result;
+	}
+
+	std::vector<std::pair<int, std::vector<int>>> readTopology()
+	{
+		std::vector<std::pair<int, std::vector<int>>> result;
+		std::ifstream onlineFile { "/sys/devices/system/node/online" };
+		if (!onlineFile.good()) return result;
+		std::string online;
+		std::getline(onlineFile, online);
+		for (auto node : parseList(online))
+		{
+			if (node < 0 || (size_t)node >= MaxNodes) continue;
+			std::ifstream file { "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist" };
+			if (!file.good()) continue;
+			std::string list;
+			std::getline(file, list);
+			auto cpus = parseList(list);
+			//memory-only nodes
+			if (cpus.size() == 0) continue;
+			result.emplace_back(node, cpus);
+		}
+		return result;
+	}
+}
+
+namespace Numa
+{
+	std::vector<std::vector<int>> NodeCpus()
+	{
+		std::vector<std::vector<int>> result;
+		for (auto& node : readTopology()) result.push_back(node.second);
+		return result;
+	}
+
+	std::vector<int> NodeIds()
+	{
+		std::vector<int> result;
+		for (auto& node : readTopology()) result.push_back(node.first);
+		return result;
+	}
+
+	bool PinThread(const std::vector<int>& cpus)
+	{
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (auto cpu : cpus)
+		{
+			if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+		}
+		return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+		return false;
+#endif
+	}
+
+	bool InterleaveAllocations(const std::vector<int>& nodes)
+	{
+#ifdef __linux__
+		std::vector<unsigned long> mask;
+		size_t bitsPerWord = sizeof(unsigned long) * 8;
+		mask.resize(MaxNodes / bitsPerWord, 0);
+		for (auto node : nodes)
+		{
+			if (node < 0 || (size_t)node >= MaxNodes) continue;
+			mask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+		}
+		return syscall(SYS_set_mempolicy, MPOL_INTERLEAVE, mask.data(), MaxNodes + 1) == 0;
+#else
+		return false;
+#endif
+	}
+
+	bool DefaultAllocations()
+	{
+#ifdef __linux__
+		return syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0) == 0;
+#else
+		return false;
+#endif
+	}
+}
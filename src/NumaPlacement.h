@@ -0,0 +1,23 @@
+#ifndef NumaPlacement_h
+#define NumaPlacement_h
+
+#include <vector>
+#include <string>
+
+//thread and memory placement on multi-socket machines using the kernel interface directly, without libnuma.
+//the allocations of a thread land on the node where the thread first touches the memory, unless a memory policy says otherwise
+namespace Numa
+{
+	//cpus of each NUMA node which has cpus. empty if the topology is not available
+	std::vector<std::vector<int>> NodeCpus();
+	//node ids matching NodeCpus()
+	std::vector<int> NodeIds();
+	//restricts the calling thread to the given cpus
+	bool PinThread(const std::vector<int>& cpus);
+	//spreads the pages allocated by the calling thread, and threads it creates, evenly over the nodes
+	bool InterleaveAllocations(const std::vector<int>& nodes);
+	//allocations by the calling thread go back to the node which touches them first
+	bool DefaultAllocations();
+}
+
+#endif
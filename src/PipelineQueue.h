@@ -0,0 +1,179 @@
+#ifndef PipelineQueue_h
+#define PipelineQueue_h
+
+#include <cassert>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <blockingconcurrentqueue.h> //https://github.com/cameron314/concurrentqueue
+
+//limits how many items and how many bytes can be in a queue at once, producers block while it is full
+class QueueCapacity
+{
+public:
+	QueueCapacity(size_t maxItems, size_t maxBytes) :
+	usedItems(0),
+	usedBytes(0),
+	maxItems(maxItems),
+	maxBytes(maxBytes)
+	{
+	}
+	void acquire(size_t items, size_t bytes)
+	{
+		std::unique_lock<std::mutex> lock { mutex };
+		//an item bigger than the whole capacity is let through once the queue is empty
+		changed.wait(lock, [this, items, bytes]() { return usedItems == 0 || (usedItems + items <= maxItems && usedBytes + bytes <= maxBytes); });
+		usedItems += items;
+		usedBytes += bytes;
+	}
+	void release(size_t items, size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		assert(usedItems >= items);
+		assert(usedBytes >= bytes);
+		usedItems -= items;
+		usedBytes -= bytes;
+		changed.notify_all();
+	}
+private:
+	std::mutex mutex;
+	std::condition_variable changed;
+	size_t usedItems;
+	size_t usedBytes;
+	size_t maxItems;
+	size_t maxBytes;
+};
+
+//keeps numbered items of parallel producers close to the order in which they are consumed.
+//producers wait before handing out an item too far ahead of the next item the consumer needs,
+//so a consumer putting the items back in order never has to buffer more than windowSize items
+class ReorderWindow
+{
+public:
+	ReorderWindow(size_t windowSize) :
+	nextNumber(0),
+	windowSize(windowSize)
+	{
+		assert(windowSize > 0);
+	}
+	size_t size() const
+	{
+		return windowSize;
+	}
+	void waitForTurn(size_t number)
+	{
+		std::unique_lock<std::mutex> lock { mutex };
+		//the item the consumer is waiting for always gets through
+		changed.wait(lock, [this, number]() { return number < nextNumber + windowSize; });
+	}
+	void advance(size_t newNextNumber)
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		assert(newNextNumber >= nextNumber);
+		nextNumber = newNextNumber;
+		changed.notify_all();
+	}
+private:
+	std::mutex mutex;
+	std::condition_variable changed;
+	size_t nextNumber;
+	size_t windowSize;
+};
+
+//bounded queue between pipeline stages. consumers sleep while it is empty and producers while it is full
+//T must be a pointer type, a null item marks the end of the stream
+//itemBytes tells how much memory an item holds, it must not change while the item is in the queue
+template <typename T>
+class PipelineQueue
+{
+public:
+	PipelineQueue(size_t maxItems, size_t maxBytes, size_t numProducers, std::function<size_t(const T&)> itemBytes) :
+	queue(50, numProducers, numProducers),
+	capacity(maxItems, maxBytes),
+	itemBytes(itemBytes)
+	{
+	}
+	PipelineQueue(const PipelineQueue& other) = delete;
+	PipelineQueue& operator=(const PipelineQueue& other) = delete;
+	moodycamel::BlockingConcurrentQueue<T>& rawQueue()
+	{
+		return queue;
+	}
+	void enqueue(moodycamel::ProducerToken& token, T item)
+	{
+		assert(item != nullptr);
+		capacity.acquire(1, itemBytes(item));
+		queue.enqueue(token, std::move(item));
+	}
+	void enqueue(T item)
+	{
+		assert(item != nullptr);
+		capacity.acquire(1, itemBytes(item));
+		queue.enqueue(std::move(item));
+	}
+	//called once all producers are done
+	void close()
+	{
+		queue.enqueue(T{});
+	}
+	//blocks until there are items, returns 0 once the queue is closed and empty
+	size_t dequeueBulk(T* items, size_t maxItems)
+	{
+		size_t got = queue.wait_dequeue_bulk(items, maxItems);
+		return afterDequeue(items, maxItems, got);
+	}
+	size_t dequeueBulk(moodycamel::ConsumerToken& token, T* items, size_t maxItems)
+	{
+		size_t got = queue.wait_dequeue_bulk(token, items, maxItems);
+		return afterDequeue(items, maxItems, got);
+	}
+	bool dequeue(T& item)
+	{
+		return dequeueBulk(&item, 1) == 1;
+	}
+	bool dequeue(moodycamel::ConsumerToken& token, T& item)
+	{
+		return dequeueBulk(token, &item, 1) == 1;
+	}
+private:
+	size_t afterDequeue(T* items, size_t maxItems, size_t got)
+	{
+		bool ended = false;
+		size_t kept = removeEndMarker(items, got, ended);
+		if (ended)
+		{
+			//the end marker can overtake items of other producers, so drain them before finishing
+			if (kept == 0)
+			{
+				got = queue.try_dequeue_bulk(items, maxItems);
+				kept = removeEndMarker(items, got, ended);
+			}
+			//leave the marker for the other consumers
+			queue.enqueue(T{});
+		}
+		size_t bytes = 0;
+		for (size_t i = 0; i < kept; i++) bytes += itemBytes(items[i]);
+		capacity.release(kept, bytes);
+		return kept;
+	}
+	size_t removeEndMarker(T* items, size_t count, bool& ended)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (items[i] == nullptr)
+			{
+				ended = true;
+				continue;
+			}
+			if (kept != i) items[kept] = std::move(items[i]);
+			kept++;
+		}
+		return kept;
+	}
+	moodycamel::BlockingConcurrentQueue<T> queue;
+	QueueCapacity capacity;
+	std::function<size_t(const T&)> itemBytes;
+};
+
+#endif
@@ -8,10 +8,10 @@
 #include "stream.hpp"
 #include "fastqloader.h"
 #include "CommonUtils.h"
+#include "BinaryAlignment.h"
 
 std::atomic<bool> readingDone;
 std::atomic<bool> splittingDone;
-std::vector<vg::Alignment*> cleanup;
 
 size_t allAlnsCount = 0;
 size_t selectedAlnCount = 0;
@@ -32,7 +32,90 @@ std::unordered_map<std::string, size_t> getReadLengths(std::string readFile)
 	return result;
 }
 
-void loadAlignments(std::string filename, moodycamel::ConcurrentQueue<vg::Alignment*>& output)
+//the same steps work on GAM alignments and binary alignment records, these give the fields the steps need
+const std::string& alignmentName(const vg::Alignment& aln)
+{
+	return aln.name();
+}
+
+const std::string& alignmentName(const BinaryAlignment::Record& aln)
+{
+	return aln.name;
+}
+
+size_t alignmentStart(const vg::Alignment& aln)
+{
+	return aln.query_position();
+}
+
+size_t alignmentStart(const BinaryAlignment::Record& aln)
+{
+	return aln.queryStart;
+}
+
+size_t alignmentEnd(const vg::Alignment& aln)
+{
+	return aln.query_position() + aln.sequence().size();
+}
+
+size_t alignmentEnd(const BinaryAlignment::Record& aln)
+{
+	return aln.queryEnd;
+}
+
+int64_t alignmentScore(const vg::Alignment& aln)
+{
+	return aln.score();
+}
+
+int64_t alignmentScore(const BinaryAlignment::Record& aln)
+{
+	return aln.score;
+}
+
+void writeBatch(std::ofstream& outfile, std::vector<vg::Alignment*>& alns)
+{
+	stream::write_buffered_ptr(outfile, alns, 0);
+}
+
+void writeBatch(std::ofstream& outfile, std::vector<BinaryAlignment::Record*>& alns)
+{
+	std::string buffer;
+	for (auto aln : alns)
+	{
+		BinaryAlignment::AppendRecord(buffer, *aln);
+	}
+	outfile.write(buffer.data(), buffer.size());
+}
+
+void loadAlignments(std::string filename, moodycamel::ConcurrentQueue<BinaryAlignment::Record*>& output, std::vector<BinaryAlignment::Record*>& cleanup)
+{
+	BinaryAlignment::Record* current[100];
+	size_t countCurrent = 0;
+	BinaryAlignment::Reader reader { filename };
+	BinaryAlignment::Record* ptr = new BinaryAlignment::Record;
+	while (reader.next(*ptr))
+	{
+		cleanup.push_back(ptr);
+		current[countCurrent] = ptr;
+		countCurrent++;
+		if (countCurrent == 100)
+		{
+			output.enqueue_bulk(current, 100);
+			countCurrent = 0;
+		}
+		ptr = new BinaryAlignment::Record;
+	}
+	delete ptr;
+	if (countCurrent > 0)
+	{
+		output.enqueue_bulk(current, countCurrent);
+	}
+
+	readingDone = true;
+}
+
+void loadAlignments(std::string filename, moodycamel::ConcurrentQueue<vg::Alignment*>& output, std::vector<vg::Alignment*>& cleanup)
 {
 	vg::Alignment* current[100];
 	size_t countCurrent = 0;
@@ -58,11 +141,12 @@ void loadAlignments(std::string filename, moodycamel::ConcurrentQueue<vg::Alignm
 	readingDone = true;
 }
 
-void splitAlignmentsIntoSelectedAndFullLength(const std::unordered_map<std::string, size_t>& readLengths, moodycamel::ConcurrentQueue<vg::Alignment*>& inputAlns, moodycamel::ConcurrentQueue<vg::Alignment*>& outputSelected, moodycamel::ConcurrentQueue<vg::Alignment*>& outputFullLength)
+template <typename T>
+void splitAlignmentsIntoSelectedAndFullLength(const std::unordered_map<std::string, size_t>& readLengths, moodycamel::ConcurrentQueue<T*>& inputAlns, moodycamel::ConcurrentQueue<T*>& outputSelected, moodycamel::ConcurrentQueue<T*>& outputFullLength)
 {
-	vg::Alignment* alns[100] {};
+	T* alns[100] {};
 
-	std::unordered_map<std::string, std::vector<vg::Alignment*>> alnsPerRead;
+	std::unordered_map<std::string, std::vector<T*>> alnsPerRead;
 	while (true)
 	{
 		size_t gotAlns = inputAlns.try_dequeue_bulk(alns, 100);
@@ -74,24 +158,24 @@ void splitAlignmentsIntoSelectedAndFullLength(const std::unordered_map<std::stri
 		}
 		for (size_t i = 0; i < gotAlns; i++)
 		{
-			alnsPerRead[alns[i]->name()].push_back(alns[i]);
+			alnsPerRead[alignmentName(*alns[i])].push_back(alns[i]);
 		}
 	}
 
 	for (auto pair : alnsPerRead)
 	{
-		auto selected = CommonUtils::SelectAlignments(pair.second, std::numeric_limits<size_t>::max());
+		auto selected = CommonUtils::SelectAlignments(pair.second, std::numeric_limits<size_t>::max(), [](T* aln) { return alignmentStart(*aln); }, [](T* aln) { return alignmentEnd(*aln); }, [](T* aln) { return alignmentScore(*aln); });
 		outputSelected.enqueue_bulk(selected.data(), selected.size());
 		allAlnsCount += pair.second.size();
 		selectedAlnCount += selected.size();
 		for (auto ptr : selected)
 		{
-			bpInSelected += ptr->sequence().size();
+			bpInSelected += alignmentEnd(*ptr) - alignmentStart(*ptr);
 		}
-		if (selected[0]->sequence().size() >= readLengths.at(pair.first) - 1)
+		if (alignmentEnd(*selected[0]) - alignmentStart(*selected[0]) >= readLengths.at(pair.first) - 1)
 		{
 			outputFullLength.enqueue(selected[0]);
-			bpInFull += selected[0]->sequence().size();
+			bpInFull += alignmentEnd(*selected[0]) - alignmentStart(*selected[0]);
 			fullLengthAlnCount += 1;
 		}
 	}
@@ -101,11 +185,14 @@ void splitAlignmentsIntoSelectedAndFullLength(const std::unordered_map<std::stri
 	splittingDone = true;
 }
 
-void writeAlignments(std::string filename, moodycamel::ConcurrentQueue<vg::Alignment*>& inputAlns)
+//the output is in the same format as the input
+template <typename T>
+void writeAlignments(std::string filename, moodycamel::ConcurrentQueue<T*>& inputAlns, bool binaryFile)
 {
 	std::ofstream outfile { filename,  std::ios::out | std::ios::binary };
+	if (binaryFile) outfile.write(BinaryAlignment::FileHeader().data(), BinaryAlignment::FileHeader().size());
 
-	std::vector<vg::Alignment*> alns;
+	std::vector<T*> alns;
 	alns.resize(1000, nullptr);
 
 	while (true)
@@ -119,7 +206,32 @@ void writeAlignments(std::string filename, moodycamel::ConcurrentQueue<vg::Align
 			continue;
 		}
 		alns.resize(gotAlns);
-		stream::write_buffered_ptr(outfile, alns, 0);
+		writeBatch(outfile, alns);
+	}
+}
+
+template <typename T>
+void processAlignments(const std::string& rawAlnFile, const std::unordered_map<std::string, size_t>& readLengths, const std::string& outputSelectedAlnFile, const std::string& outputFullLengthAlnFile, bool binaryFile)
+{
+	std::vector<T*> cleanup;
+
+	moodycamel::ConcurrentQueue<T*> readToSplitting;
+	moodycamel::ConcurrentQueue<T*> splitToSelected;
+	moodycamel::ConcurrentQueue<T*> splitToFullLength;
+
+	std::thread readThread {[&rawAlnFile, &readToSplitting, &cleanup](){loadAlignments(rawAlnFile, readToSplitting, cleanup);}};
+	std::thread splitter {[&readToSplitting, &splitToSelected, &splitToFullLength, &readLengths](){splitAlignmentsIntoSelectedAndFullLength(readLengths, readToSplitting, splitToSelected, splitToFullLength);}};
+	std::thread selectedWriter {[&splitToSelected, &outputSelectedAlnFile, binaryFile](){writeAlignments(outputSelectedAlnFile, splitToSelected, binaryFile);}};
+	std::thread fullLengthWriter {[&splitToFullLength, &outputFullLengthAlnFile, binaryFile](){writeAlignments(outputFullLengthAlnFile, splitToFullLength, binaryFile);}};
+
+	readThread.join();
+	splitter.join();
+	selectedWriter.join();
+	fullLengthWriter.join();
+
+	for (auto aln : cleanup)
+	{
+		delete aln;
 	}
 }
 
@@ -136,23 +248,13 @@ int main(int argc, char** argv)
 
 	auto readLengths = getReadLengths(readsFile);
 
-	moodycamel::ConcurrentQueue<vg::Alignment*> readToSplitting;
-	moodycamel::ConcurrentQueue<vg::Alignment*> splitToSelected;
-	moodycamel::ConcurrentQueue<vg::Alignment*> splitToFullLength;
-
-	std::thread readThread {[&rawAlnFile, &readToSplitting](){loadAlignments(rawAlnFile, readToSplitting);}};
-	std::thread splitter {[&readToSplitting, &splitToSelected, &splitToFullLength, &readLengths](){splitAlignmentsIntoSelectedAndFullLength(readLengths, readToSplitting, splitToSelected, splitToFullLength);}};
-	std::thread selectedWriter {[&splitToSelected, &outputSelectedAlnFile](){writeAlignments(outputSelectedAlnFile, splitToSelected);}};
-	std::thread fullLengthWriter {[&splitToFullLength, &outputFullLengthAlnFile](){writeAlignments(outputFullLengthAlnFile, splitToFullLength);}};
-
-	readThread.join();
-	splitter.join();
-	selectedWriter.join();
-	fullLengthWriter.join();
-
-	for (auto aln : cleanup)
+	if (BinaryAlignment::IsBinaryAlignmentFile(rawAlnFile))
 	{
-		delete aln;
+		processAlignments<BinaryAlignment::Record>(rawAlnFile, readLengths, outputSelectedAlnFile, outputFullLengthAlnFile, true);
+	}
+	else
+	{
+		processAlignments<vg::Alignment>(rawAlnFile, readLengths, outputSelectedAlnFile, outputFullLengthAlnFile, false);
 	}
 
 	for (auto pair : readLengths)
@@ -1,64 +1,82 @@
 #include "ThreadReadAssertion.h"
 #include "ReadCorrection.h"
 
-std::string toUpper(std::string seq)
+void appendUpper(std::string& out, const std::string& seq, size_t start, size_t length)
 {
-	for (auto& c : seq)
-	{
-		c = toupper(c);
-	}
-	return seq;
+	size_t oldSize = out.size();
+	out.append(seq, start, length);
+	for (size_t i = oldSize; i < out.size(); i++) out[i] = toupper(out[i]);
 }
 
-std::string toLower(std::string seq)
+void appendLower(std::string& out, const std::string& seq, size_t start, size_t length)
 {
-	for (auto& c : seq)
-	{
-		c = tolower(c);
-	}
-	return seq;
+	size_t oldSize = out.size();
+	out.append(seq, start, length);
+	for (size_t i = oldSize; i < out.size(); i++) out[i] = tolower(out[i]);
 }
 
-size_t getLongestOverlap(const std::string& left, const std::string& right, size_t maxOverlap)
+//longest suffix of left[0, leftSize) which is a prefix of right, at most maxOverlap long.
+//runs the KMP automaton of right's prefix over the end of left, linear in maxOverlap
+size_t getLongestOverlap(const char* left, size_t leftSize, const std::string& right, size_t maxOverlap)
 {
-	if (left.size() < maxOverlap) maxOverlap = left.size();
+	if (leftSize < maxOverlap) maxOverlap = leftSize;
 	if (right.size() < maxOverlap) maxOverlap = right.size();
-	for (size_t i = maxOverlap; i > 0; i--)
+	if (maxOverlap == 0) return 0;
+	//failure[i]: length of the longest proper border of right[0, i]
+	thread_local std::vector<size_t> failure;
+	failure.resize(maxOverlap);
+	failure[0] = 0;
+	size_t border = 0;
+	for (size_t i = 1; i < maxOverlap; i++)
 	{
-		bool match = true;
-		for (size_t a = 0; a < i && match; a++)
-		{
-			if (left[left.size() - maxOverlap + a] != right[a]) match = false;
-		}
-		if (match) return i;
+		while (border > 0 && right[i] != right[border]) border = failure[border-1];
+		if (right[i] == right[border]) border++;
+		failure[i] = border;
+	}
+	size_t matched = 0;
+	for (size_t i = leftSize - maxOverlap; i < leftSize; i++)
+	{
+		if (matched == maxOverlap) matched = failure[matched-1];
+		while (matched > 0 && left[i] != right[matched]) matched = failure[matched-1];
+		if (left[i] == right[matched]) matched++;
 	}
-	return 0;
+	return matched;
 }
 
-std::string getCorrected(const std::string& raw, const std::vector<Correction>& corrections, size_t maxOverlap)
+void appendCorrected(std::string& out, const std::string& raw, const std::vector<Correction>& corrections, size_t maxOverlap)
 {
-	std::string result;
+	size_t readStart = out.size();
+	size_t reserved = raw.size();
+	for (const auto& correction : corrections) reserved += correction.corrected.size();
+	out.reserve(readStart + reserved);
 	size_t currentEnd = 0;
 	for (size_t i = 0; i < corrections.size(); i++)
 	{
 		assert(i == 0 || corrections[i].startIndex >= corrections[i-1].startIndex);
+		const std::string& corrected = corrections[i].corrected;
 		if (corrections[i].startIndex < currentEnd)
 		{
-			size_t overlap = getLongestOverlap(result, corrections[i].corrected, maxOverlap);
-			result += toUpper(corrections[i].corrected.substr(overlap));
+			size_t overlap = getLongestOverlap(out.data() + readStart, out.size() - readStart, corrected, maxOverlap);
+			appendUpper(out, corrected, overlap, corrected.size() - overlap);
 		}
 		else if (corrections[i].startIndex > currentEnd)
 		{
-			result += toLower(raw.substr(currentEnd, corrections[i].startIndex - currentEnd));
-			result += toUpper(corrections[i].corrected);
+			appendLower(out, raw, currentEnd, corrections[i].startIndex - currentEnd);
+			appendUpper(out, corrected, 0, corrected.size());
 		}
 		else
 		{
 			assert(corrections[i].startIndex == currentEnd);
-			result += toUpper(corrections[i].corrected);
+			appendUpper(out, corrected, 0, corrected.size());
 		}
 		currentEnd = corrections[i].endIndex;
 	}
-	if (currentEnd < raw.size()) result += toLower(raw.substr(currentEnd));
+	if (currentEnd < raw.size()) appendLower(out, raw, currentEnd, raw.size() - currentEnd);
+}
+
+std::string getCorrected(const std::string& raw, const std::vector<Correction>& corrections, size_t maxOverlap)
+{
+	std::string result;
+	appendCorrected(result, raw, corrections, maxOverlap);
 	return result;
 }
@@ -11,6 +11,9 @@ struct Correction
 	std::string corrected;
 };
 
+//appends the read with the corrected parts in upper case and the uncorrected parts in lower case.
+//the corrections must be sorted by start, overlapping corrections are joined at their longest exact overlap
+void appendCorrected(std::string& out, const std::string& raw, const std::vector<Correction>& corrections, size_t maxOverlap);
 std::string getCorrected(const std::string& raw, const std::vector<Correction>& corrections, size_t maxOverlap);
 
 #endif
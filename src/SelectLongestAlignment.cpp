@@ -4,28 +4,46 @@
 #include "CommonUtils.h"
 #include "fastqloader.h"
 #include "stream.hpp"
+#include "BinaryAlignment.h"
 
-int main(int argc, char** argv)
+//the longest alignment of each read, the lowest score between equally long ones
+template <typename T, typename NameGetter, typename LengthGetter, typename ScoreGetter>
+std::vector<T> selectLongest(const std::vector<T>& alns, NameGetter getName, LengthGetter getLength, ScoreGetter getScore)
 {
-	std::string alnfile { argv[1] };
-	std::string outfile { argv[2] };
-
-	auto alns = CommonUtils::LoadVGAlignments(alnfile);
-
-	std::unordered_map<std::string, vg::Alignment> result;
-	for (auto aln : alns)
+	std::unordered_map<std::string, T> result;
+	for (const auto& aln : alns)
 	{
-		if (result.count(aln.name()) == 0) result[aln.name()] = aln;
-		else if (aln.sequence().size() > result[aln.name()].sequence().size()) result[aln.name()] = aln;
-		else if (aln.sequence().size() == result[aln.name()].sequence().size() && aln.score() < result[aln.name()].score()) result[aln.name()] = aln;
+		auto found = result.find(getName(aln));
+		if (found == result.end()) result[getName(aln)] = aln;
+		else if (getLength(aln) > getLength(found->second)) found->second = aln;
+		else if (getLength(aln) == getLength(found->second) && getScore(aln) < getScore(found->second)) found->second = aln;
 	}
 
-	std::vector<vg::Alignment> writeAlns;
+	std::vector<T> writeAlns;
 	writeAlns.reserve(result.size());
 	for (auto pair : result)
 	{
 		writeAlns.push_back(pair.second);
 	}
+	return writeAlns;
+}
+
+int main(int argc, char** argv)
+{
+	std::string alnfile { argv[1] };
+	std::string outfile { argv[2] };
+
+	//the output is in the same format as the input
+	if (BinaryAlignment::IsBinaryAlignmentFile(alnfile))
+	{
+		auto alns = BinaryAlignment::LoadRecords(alnfile);
+		auto writeAlns = selectLongest(alns, [](const BinaryAlignment::Record& aln) -> const std::string& { return aln.name; }, [](const BinaryAlignment::Record& aln) { return aln.queryEnd - aln.queryStart; }, [](const BinaryAlignment::Record& aln) { return aln.score; });
+		BinaryAlignment::WriteRecords(outfile, writeAlns);
+		return 0;
+	}
+
+	auto alns = CommonUtils::LoadVGAlignments(alnfile);
+	auto writeAlns = selectLongest(alns, [](const vg::Alignment& aln) -> const std::string& { return aln.name(); }, [](const vg::Alignment& aln) { return aln.sequence().size(); }, [](const vg::Alignment& aln) { return aln.score(); });
 
 	std::ofstream resultFile { outfile, std::ios::out | std::ios::binary };
 	stream::write_buffered(resultFile, writeAlns, 0);
@@ -0,0 +1,348 @@
+#ifndef ThreadedGzipStream_h
+#define ThreadedGzipStream_h
+
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <istream>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <zlib.h>
+
+//decompresses a gzip file on a separate thread so parsing and inflating run in parallel.
+//BGZF files (eg. from bgzip) consist of independent blocks which are inflated by several threads at once,
+//other gzip files (including concatenated members) are inflated sequentially on the decompressor thread
+class ThreadedGzipStreambuf : public std::streambuf
+{
+public:
+	ThreadedGzipStreambuf(const std::string& filename, size_t numThreads) :
+	filename(filename),
+	numThreads(std::max<size_t>(numThreads, 1)),
+	current(),
+	chunks(),
+	finished(false),
+	stopped(false),
+	error()
+	{
+		setg(nullptr, nullptr, nullptr);
+		decompressorThread = std::thread { [this]() { decompress(); } };
+	}
+	~ThreadedGzipStreambuf()
+	{
+		{
+			std::lock_guard<std::mutex> lock { mutex };
+			stopped = true;
+		}
+		changed.notify_all();
+		decompressorThread.join();
+	}
+	ThreadedGzipStreambuf(const ThreadedGzipStreambuf& other) = delete;
+	ThreadedGzipStreambuf& operator=(const ThreadedGzipStreambuf& other) = delete;
+protected:
+	int_type underflow() override
+	{
+		if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+		std::unique_lock<std::mutex> lock { mutex };
+		changed.wait(lock, [this]() { return chunks.size() > 0 || finished; });
+		if (chunks.size() == 0)
+		{
+			if (error.size() > 0) throw std::runtime_error { "Error decompressing " + filename + ": " + error };
+			return traits_type::eof();
+		}
+		current = std::move(chunks.front());
+		chunks.pop_front();
+		lock.unlock();
+		changed.notify_all();
+		setg(&current[0], &current[0], &current[0] + current.size());
+		return traits_type::to_int_type(*gptr());
+	}
+private:
+	static constexpr size_t MaxQueuedChunks = 4;
+	static constexpr size_t SequentialChunkSize = 1024 * 1024;
+	static constexpr size_t BlocksPerGroup = 16;
+	struct BgzfBlock
+	{
+		std::string compressed;
+		std::string decompressed;
+		bool ok;
+	};
+	//returns false if the parser has gone away
+	bool pushChunk(std::string&& chunk)
+	{
+		if (chunk.size() == 0) return true;
+		std::unique_lock<std::mutex> lock { mutex };
+		changed.wait(lock, [this]() { return stopped || chunks.size() < MaxQueuedChunks; });
+		if (stopped) return false;
+		chunks.emplace_back(std::move(chunk));
+		lock.unlock();
+		changed.notify_all();
+		return true;
+	}
+	void finish(const std::string& errorMessage)
+	{
+		{
+			std::lock_guard<std::mutex> lock { mutex };
+			finished = true;
+			error = errorMessage;
+		}
+		changed.notify_all();
+	}
+	void decompress()
+	{
+		std::ifstream file { filename, std::ios::in | std::ios::binary };
+		if (!file.good())
+		{
+			finish("could not open file");
+			return;
+		}
+		std::string errorMessage;
+		//files which are not compressed at all are passed through like zstr does
+		if (file.peek() != 0x1f && file.peek() != 0x78)
+		{
+			copyUncompressed(file);
+			finish(errorMessage);
+			return;
+		}
+		if (!decompressBgzf(file, errorMessage) && errorMessage.size() == 0)
+		{
+			decompressSequential(file, errorMessage);
+		}
+		finish(errorMessage);
+	}
+	//reads the next block if it is a BGZF block. leaves the file at the start of the member otherwise
+	bool readBgzfBlock(std::ifstream& file, std::string& block, bool& isEof, std::string& errorMessage)
+	{
+		isEof = false;
+		std::streampos memberStart = file.tellg();
+		char header[12];
+		file.read(header, 12);
+		if (file.gcount() == 0)
+		{
+			isEof = true;
+			return true;
+		}
+		if (file.gcount() < 12 || (unsigned char)header[0] != 0x1f || (unsigned char)header[1] != 0x8b || header[2] != 8 || (header[3] & 4) == 0)
+		{
+			file.clear();
+			file.seekg(memberStart);
+			return false;
+		}
+		size_t extraLength = (unsigned char)header[10] + ((size_t)(unsigned char)header[11] << 8);
+		std::string extra;
+		extra.resize(extraLength);
+		file.read(&extra[0], extraLength);
+		size_t blockSize = 0;
+		for (size_t i = 0; i + 4 <= extraLength && file.gcount() == (std::streamsize)extraLength; )
+		{
+			size_t subfieldLength = (unsigned char)extra[i+2] + ((size_t)(unsigned char)extra[i+3] << 8);
+			if (extra[i] == 'B' && extra[i+1] == 'C' && subfieldLength == 2 && i + 6 <= extraLength)
+			{
+				blockSize = (unsigned char)extra[i+4] + ((size_t)(unsigned char)extra[i+5] << 8) + 1;
+				break;
+			}
+			i += 4 + subfieldLength;
+		}
+		if (blockSize == 0)
+		{
+			file.clear();
+			file.seekg(memberStart);
+			return false;
+		}
+		if (blockSize < 12 + extraLength + 8)
+		{
+			errorMessage = "invalid BGZF block size";
+			return false;
+		}
+		block.resize(blockSize - 12 - extraLength);
+		file.read(&block[0], block.size());
+		if (file.gcount() != (std::streamsize)block.size())
+		{
+			errorMessage = "truncated BGZF block";
+			return false;
+		}
+		return true;
+	}
+	static void inflateBgzfBlock(BgzfBlock& block)
+	{
+		//deflate data followed by CRC32 and uncompressed size
+		const std::string& data = block.compressed;
+		size_t payloadSize = data.size() - 8;
+		uint32_t expectedCrc = 0;
+		uint32_t expectedSize = 0;
+		for (size_t i = 0; i < 4; i++)
+		{
+			expectedCrc |= (uint32_t)(unsigned char)data[payloadSize + i] << (8 * i);
+			expectedSize |= (uint32_t)(unsigned char)data[payloadSize + 4 + i] << (8 * i);
+		}
+		block.decompressed.resize(expectedSize);
+		block.ok = false;
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		if (inflateInit2(&stream, -15) != Z_OK) return;
+		stream.next_in = (Bytef*)data.data();
+		stream.avail_in = payloadSize;
+		//zlib refuses a null output buffer even for the empty end of file block
+		Bytef emptyOutput;
+		stream.next_out = expectedSize > 0 ? (Bytef*)&block.decompressed[0] : &emptyOutput;
+		stream.avail_out = expectedSize;
+		int result = inflate(&stream, Z_FINISH);
+		size_t produced = expectedSize - stream.avail_out;
+		inflateEnd(&stream);
+		if (result != Z_STREAM_END || produced != expectedSize) return;
+		if (crc32(0, (const Bytef*)block.decompressed.data(), expectedSize) != expectedCrc) return;
+		block.ok = true;
+	}
+	//returns true if the whole file was BGZF
+	bool decompressBgzf(std::ifstream& file, std::string& errorMessage)
+	{
+		std::vector<BgzfBlock> blocks;
+		blocks.resize(BlocksPerGroup * numThreads);
+		while (true)
+		{
+			size_t numBlocks = 0;
+			bool isEof = false;
+			bool notBgzf = false;
+			while (numBlocks < blocks.size())
+			{
+				if (!readBgzfBlock(file, blocks[numBlocks].compressed, isEof, errorMessage))
+				{
+					if (errorMessage.size() > 0) return false;
+					notBgzf = true;
+					break;
+				}
+				if (isEof) break;
+				numBlocks++;
+			}
+			#pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+			for (size_t i = 0; i < numBlocks; i++)
+			{
+				inflateBgzfBlock(blocks[i]);
+			}
+			std::string chunk;
+			size_t chunkSize = 0;
+			for (size_t i = 0; i < numBlocks; i++)
+			{
+				if (!blocks[i].ok)
+				{
+					errorMessage = "corrupted BGZF block";
+					return false;
+				}
+				chunkSize += blocks[i].decompressed.size();
+			}
+			chunk.reserve(chunkSize);
+			for (size_t i = 0; i < numBlocks; i++)
+			{
+				chunk += blocks[i].decompressed;
+			}
+			if (!pushChunk(std::move(chunk))) return true;
+			//the rest of the file is regular gzip, continue sequentially from this member
+			if (notBgzf) return false;
+			if (isEof) return true;
+		}
+	}
+	void copyUncompressed(std::ifstream& file)
+	{
+		while (true)
+		{
+			std::string chunk;
+			chunk.resize(SequentialChunkSize);
+			file.read(&chunk[0], chunk.size());
+			chunk.resize(file.gcount());
+			if (chunk.size() == 0) break;
+			if (!pushChunk(std::move(chunk))) break;
+		}
+	}
+	void decompressSequential(std::ifstream& file, std::string& errorMessage)
+	{
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		//32: detect gzip or zlib header automatically
+		if (inflateInit2(&stream, 15 + 32) != Z_OK)
+		{
+			errorMessage = "could not initialize zlib";
+			return;
+		}
+		std::vector<char> inputBuffer;
+		inputBuffer.resize(SequentialChunkSize);
+		std::string chunk;
+		chunk.resize(SequentialChunkSize);
+		size_t produced = 0;
+		bool inMember = false;
+		while (true)
+		{
+			if (stream.avail_in == 0)
+			{
+				file.read(inputBuffer.data(), inputBuffer.size());
+				if (file.gcount() == 0) break;
+				stream.next_in = (Bytef*)inputBuffer.data();
+				stream.avail_in = file.gcount();
+			}
+			stream.next_out = (Bytef*)&chunk[produced];
+			stream.avail_out = chunk.size() - produced;
+			inMember = true;
+			int result = inflate(&stream, Z_NO_FLUSH);
+			produced = chunk.size() - stream.avail_out;
+			if (result == Z_STREAM_END)
+			{
+				//concatenated gzip members
+				inMember = false;
+				inflateReset(&stream);
+			}
+			else if (result != Z_OK && result != Z_BUF_ERROR)
+			{
+				errorMessage = stream.msg != nullptr ? stream.msg : "invalid compressed data";
+				break;
+			}
+			if (produced == chunk.size())
+			{
+				if (!pushChunk(std::move(chunk))) break;
+				chunk.clear();
+				chunk.resize(SequentialChunkSize);
+				produced = 0;
+			}
+		}
+		inflateEnd(&stream);
+		if (errorMessage.size() > 0) return;
+		if (inMember) errorMessage = "unexpected end of file";
+		chunk.resize(produced);
+		pushChunk(std::move(chunk));
+	}
+	std::string filename;
+	size_t numThreads;
+	std::string current;
+	std::deque<std::string> chunks;
+	bool finished;
+	bool stopped;
+	std::string error;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::thread decompressorThread;
+};
+
+inline size_t DefaultDecompressionThreads()
+{
+	//a few threads inflate BGZF faster than the aligner threads can consume reads
+	return std::max<size_t>(1, std::min<size_t>(4, std::thread::hardware_concurrency()));
+}
+
+class ThreadedGzipIstream : public std::istream
+{
+public:
+	ThreadedGzipIstream(const std::string& filename, size_t numThreads) :
+	std::istream(nullptr),
+	buffer(filename, numThreads)
+	{
+		rdbuf(&buffer);
+		//report decompression errors instead of silently ending the stream
+		exceptions(std::ios_base::badbit);
+	}
+private:
+	ThreadedGzipStreambuf buffer;
+};
+
+#endif
@@ -1,65 +1,239 @@
 #ifndef FastqLoader_H
 #define FastqLoader_H
 
+#include <cassert>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
-#include <zstr.hpp> //https://github.com/mateidavid/zstr
+#include <istream>
+#include <fstream>
+#include "ThreadedGzipStream.h"
 
-class FastQ {
+class StringView
+{
+public:
+	StringView() : data(nullptr), size(0) {}
+	StringView(const char* data, size_t size) : data(data), size(size) {}
+	std::string str() const { return std::string { data, size }; }
+	void copyTo(std::string& target) const { target.assign(data, size); }
+	const char* data;
+	size_t size;
+};
+
+//a read whose fields point into the parser's buffers, valid until the callback returns
+class FastQView
+{
 public:
+	StringView seq_id;
+	StringView sequence;
+	StringView quality;
+};
+
+//kseq-style parser: reads the stream in large blocks and finds line ends with memchr.
+//single line fields are handed out as views into the block buffer, multi-line fields are joined into reused buffers.
+//records are parsed only once they are entirely in the buffer, so a record cut by the block end is parsed again after refilling
+class FastqBufferedParser
+{
+	enum class LineResult
+	{
+		Line, NeedMore, End
+	};
+	enum class RecordResult
+	{
+		Record, NeedMore, End
+	};
+public:
+	FastqBufferedParser(std::istream& stream) :
+	stream(stream),
+	buffer(),
+	bufferStart(0),
+	bufferEnd(0),
+	endOfStream(false)
+	{
+		buffer.resize(InitialBufferSize);
+	}
 	template <typename F>
-	static void streamFastqFastqFromStream(std::istream& file, bool includeQuality, F f)
+	void parseFastq(bool includeQuality, F f)
 	{
-		do
-		{
-			std::string line;
-			std::getline(file, line);
-			if (line[0] != '@') continue;
-			FastQ newread;
-			if (line.back() == '\r') line.pop_back();
-			newread.seq_id = line.substr(1);
-			std::getline(file, line);
-			if (line.back() == '\r') line.pop_back();
-			newread.sequence = line;
-			std::getline(file, line);
-			std::getline(file, line);
-			if (line.back() == '\r') line.pop_back();
-			if (includeQuality) newread.quality = line;
-			f(newread);
-		} while (file.good());
+		FastQView read;
+		parseRecords([this, includeQuality, &read](size_t& pos) { return tryParseFastq(pos, includeQuality, read); }, [&read, &f]() { f(read); });
 	}
 	template <typename F>
-	static void streamFastqFastaFromStream(std::istream& file, bool includeQuality, F f)
+	void parseFasta(bool includeQuality, F f)
+	{
+		FastQView read;
+		parseRecords([this, includeQuality, &read](size_t& pos) { return tryParseFasta(pos, includeQuality, read); }, [&read, &f]() { f(read); });
+	}
+private:
+	static constexpr size_t InitialBufferSize = 4 * 1024 * 1024;
+	template <typename Parse, typename Callback>
+	void parseRecords(Parse parse, Callback callback)
 	{
-		std::string line;
-		std::getline(file, line);
-		do
+		while (true)
 		{
-			if (line[0] != '>')
+			size_t pos = bufferStart;
+			RecordResult result = parse(pos);
+			if (result == RecordResult::End) break;
+			if (result == RecordResult::NeedMore)
 			{
-				std::getline(file, line);
+				refill();
 				continue;
 			}
-			FastQ newread;
-			if (line.back() == '\r') line.pop_back();
-			newread.seq_id = line.substr(1);
-			newread.sequence = "";
-			do
-			{
-				std::getline(file, line);
-				if (line[0] == '>') break;
-				if (line.back() == '\r') line.pop_back();
-				newread.sequence += line;
-			} while (file.good());
-			if (includeQuality)
-			{
-				for (size_t i = 0; i < newread.sequence.size(); i++)
-				{
-					newread.quality += '!';
-				}
-			}
-			f(newread);
-		} while (file.good());
+			callback();
+			bufferStart = pos;
+		}
+	}
+	//keeps the unparsed part of the buffer, grows it if a single record doesn't fit
+	void refill()
+	{
+		assert(!endOfStream);
+		if (bufferStart == 0 && bufferEnd == buffer.size())
+		{
+			buffer.resize(buffer.size() * 2);
+		}
+		else if (bufferStart > 0)
+		{
+			memmove(&buffer[0], &buffer[bufferStart], bufferEnd - bufferStart);
+			bufferEnd -= bufferStart;
+			bufferStart = 0;
+		}
+		stream.read(&buffer[bufferEnd], buffer.size() - bufferEnd);
+		bufferEnd += stream.gcount();
+		if (stream.gcount() == 0 || !stream.good()) endOfStream = true;
+	}
+	LineResult nextLine(size_t& pos, StringView& line)
+	{
+		if (pos >= bufferEnd) return endOfStream ? LineResult::End : LineResult::NeedMore;
+		size_t end;
+		const char* found = (const char*)memchr(&buffer[pos], '\n', bufferEnd - pos);
+		if (found != nullptr)
+		{
+			end = found - buffer.data();
+		}
+		else
+		{
+			//last line without a newline
+			if (!endOfStream) return LineResult::NeedMore;
+			end = bufferEnd;
+		}
+		size_t start = pos;
+		pos = end + 1;
+		if (end > start && buffer[end-1] == '\r') end--;
+		line = StringView { &buffer[start], end - start };
+		return LineResult::Line;
+	}
+	bool peekLineStart(size_t pos, char c) const
+	{
+		return pos < bufferEnd && buffer[pos] == c;
+	}
+	//field made of consecutive lines, stays a view into the buffer unless there are several lines
+	void appendLine(StringView& field, std::string& joined, size_t& numLines, const StringView& line)
+	{
+		if (numLines == 0)
+		{
+			field = line;
+		}
+		else
+		{
+			if (numLines == 1) field.copyTo(joined);
+			joined.append(line.data, line.size);
+			field = StringView { joined.data(), joined.size() };
+		}
+		numLines++;
+	}
+	RecordResult tryParseFastq(size_t& pos, bool includeQuality, FastQView& read)
+	{
+		StringView line;
+		//skip anything before the header
+		while (true)
+		{
+			LineResult result = nextLine(pos, line);
+			if (result == LineResult::End) return RecordResult::End;
+			if (result == LineResult::NeedMore) return RecordResult::NeedMore;
+			if (line.size > 0 && line.data[0] == '@') break;
+			bufferStart = pos;
+		}
+		read.seq_id = StringView { line.data + 1, line.size - 1 };
+		read.sequence = StringView {};
+		read.quality = StringView {};
+		size_t sequenceLines = 0;
+		while (true)
+		{
+			LineResult result = nextLine(pos, line);
+			if (result == LineResult::NeedMore) return RecordResult::NeedMore;
+			//truncated record, keep what there is
+			if (result == LineResult::End) return RecordResult::Record;
+			if (line.size > 0 && line.data[0] == '+') break;
+			appendLine(read.sequence, joinedSequence, sequenceLines, line);
+		}
+		//quality can start with any character, including '@' and '+', so read lines until it is as long as the sequence
+		size_t qualityLines = 0;
+		size_t qualityLength = 0;
+		while (qualityLength < read.sequence.size)
+		{
+			LineResult result = nextLine(pos, line);
+			if (result == LineResult::NeedMore) return RecordResult::NeedMore;
+			if (result == LineResult::End) break;
+			qualityLength += line.size;
+			if (includeQuality) appendLine(read.quality, joinedQuality, qualityLines, line);
+		}
+		return RecordResult::Record;
+	}
+	RecordResult tryParseFasta(size_t& pos, bool includeQuality, FastQView& read)
+	{
+		StringView line;
+		while (true)
+		{
+			LineResult result = nextLine(pos, line);
+			if (result == LineResult::End) return RecordResult::End;
+			if (result == LineResult::NeedMore) return RecordResult::NeedMore;
+			if (line.size > 0 && line.data[0] == '>') break;
+			bufferStart = pos;
+		}
+		read.seq_id = StringView { line.data + 1, line.size - 1 };
+		read.sequence = StringView {};
+		read.quality = StringView {};
+		size_t sequenceLines = 0;
+		while (!peekLineStart(pos, '>'))
+		{
+			LineResult result = nextLine(pos, line);
+			if (result == LineResult::NeedMore) return RecordResult::NeedMore;
+			if (result == LineResult::End) break;
+			appendLine(read.sequence, joinedSequence, sequenceLines, line);
+		}
+		if (includeQuality)
+		{
+			fakeQuality.assign(read.sequence.size, '!');
+			read.quality = StringView { fakeQuality.data(), fakeQuality.size() };
+		}
+		return RecordResult::Record;
+	}
+	std::istream& stream;
+	std::vector<char> buffer;
+	size_t bufferStart;
+	size_t bufferEnd;
+	bool endOfStream;
+	std::string joinedSequence;
+	std::string joinedQuality;
+	std::string fakeQuality;
+};
+
+class FastQ {
+public:
+	template <typename F>
+	static void streamFastqFastqFromStream(std::istream& file, bool includeQuality, F f)
+	{
+		FastqBufferedParser parser { file };
+		FastQ read;
+		parser.parseFastq(includeQuality, [&read, &f](const FastQView& view) { read.assign(view); f(read); });
+	}
+	template <typename F>
+	static void streamFastqFastaFromStream(std::istream& file, bool includeQuality, F f)
+	{
+		FastqBufferedParser parser { file };
+		FastQ read;
+		parser.parseFasta(includeQuality, [&read, &f](const FastQView& view) { read.assign(view); f(read); });
 	}
 	template <typename F>
 	static void streamFastqFastqFromFile(std::string filename, bool includeQuality, F f)
@@ -76,62 +250,71 @@ public:
 	template <typename F>
 	static void streamFastqFastqFromGzippedFile(std::string filename, bool includeQuality, F f)
 	{
-		zstr::ifstream file { filename };
+		ThreadedGzipIstream file { filename, DefaultDecompressionThreads() };
 		streamFastqFastqFromStream(file, includeQuality, f);
 	}
 	template <typename F>
 	static void streamFastqFastaFromGzippedFile(std::string filename, bool includeQuality, F f)
 	{
-		zstr::ifstream file { filename };
+		ThreadedGzipIstream file { filename, DefaultDecompressionThreads() };
 		streamFastqFastaFromStream(file, includeQuality, f);
 	}
+	//f gets a FastQView which is only valid during the call
 	template <typename F>
-	static void streamFastqFromFile(std::string filename, bool includeQuality, F f)
+	static void streamFastqViewsFromFile(std::string filename, bool includeQuality, F f)
 	{
 		bool gzipped = false;
-		std::string originalFilename = filename;
-		if (filename.substr(filename.size()-3) == ".gz")
-		{
-			gzipped = true;
-			filename = filename.substr(0, filename.size()-3);
-		}
+		if (filename.size() >= 3 && filename.substr(filename.size()-3) == ".gz") gzipped = true;
+		std::string unzippedName = gzipped ? filename.substr(0, filename.size()-3) : filename;
 		bool fastq = false;
 		bool fasta = false;
-		if (filename.substr(filename.size()-6) == ".fastq") fastq = true;
-		if (filename.substr(filename.size()-3) == ".fq") fastq = true;
-		if (filename.substr(filename.size()-6) == ".fasta") fasta = true;
-		if (filename.substr(filename.size()-3) == ".fa") fasta = true;
-		if (fasta)
+		if (endsWith(unzippedName, ".fastq")) fastq = true;
+		if (endsWith(unzippedName, ".fq")) fastq = true;
+		if (endsWith(unzippedName, ".fasta")) fasta = true;
+		if (endsWith(unzippedName, ".fa")) fasta = true;
+		std::ifstream plainFile;
+		std::unique_ptr<ThreadedGzipIstream> gzippedFile;
+		if (gzipped)
 		{
-			if (gzipped)
-			{
-				streamFastqFastaFromGzippedFile(originalFilename, includeQuality, f);
-				return;
-			}
-			else
-			{
-				streamFastqFastaFromFile(originalFilename, includeQuality, f);
-				return;
-			}
+			gzippedFile = std::make_unique<ThreadedGzipIstream>(filename, DefaultDecompressionThreads());
 		}
-		if (fastq)
+		else
 		{
-			if (gzipped)
-			{
-				streamFastqFastqFromGzippedFile(originalFilename, includeQuality, f);
-				return;
-			}
-			else
-			{
-				streamFastqFastqFromFile(originalFilename, includeQuality, f);
-				return;
-			}
+			plainFile.open(filename, std::ios::in | std::ios::binary);
+		}
+		std::istream& file = gzipped ? (std::istream&)*gzippedFile : (std::istream&)plainFile;
+		//unknown extension, guess from the contents
+		if (!fasta && !fastq)
+		{
+			int first = file.peek();
+			if (first == '@') fastq = true;
+			if (first == '>') fasta = true;
 		}
+		FastqBufferedParser parser { file };
+		if (fasta) parser.parseFasta(includeQuality, f);
+		if (fastq) parser.parseFastq(includeQuality, f);
+	}
+	template <typename F>
+	static void streamFastqFromFile(std::string filename, bool includeQuality, F f)
+	{
+		FastQ read;
+		streamFastqViewsFromFile(filename, includeQuality, [&read, &f](const FastQView& view) { read.assign(view); f(read); });
+	}
+	void assign(const FastQView& view)
+	{
+		view.seq_id.copyTo(seq_id);
+		view.sequence.copyTo(sequence);
+		view.quality.copyTo(quality);
 	}
 	FastQ reverseComplement() const;
 	std::string seq_id;
 	std::string sequence;
 	std::string quality;
+private:
+	static bool endsWith(const std::string& str, const std::string& suffix)
+	{
+		return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
 };
 
 std::vector<FastQ> loadFastqFromFile(std::string filename, bool includeQuality = true);